@@ -662,7 +662,7 @@ void MultiDiagonalSymmetricMatrix::CholeskyBackSolve(float* RESTRICT x, float* R
     }
 }
 
-EdgePreservingDecomposition::EdgePreservingDecomposition(int width, int height) : a0(nullptr) , a_1(nullptr), a_w(nullptr), a_w_1(nullptr), a_w1(nullptr)
+EdgePreservingDecomposition::EdgePreservingDecomposition(int width, int height) : cancelToken(nullptr), a0(nullptr) , a_1(nullptr), a_w(nullptr), a_w_1(nullptr), a_w1(nullptr)
 {
     w = width;
     h = height;
@@ -879,6 +879,10 @@ float *EdgePreservingDecomposition::CreateIteratedBlur(float *Source, float Scal
     Reweightings++;
 
     for(int i = 0; i < Reweightings; i++) {
+        if(cancelToken && cancelToken->isCancelled()) {
+            break;
+        }
+
         CreateBlur(Source, Scale, EdgeStopping, Iterates, Blur, true);
     }
 
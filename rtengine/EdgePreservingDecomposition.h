@@ -70,6 +70,7 @@ ben_s or nonbasketless. Enjoy!
 
 #include "opthelper.h"
 #include "noncopyable.h"
+#include "canceltoken.h"
 
 //This is for solving big symmetric positive definite linear problems.
 float *SparseConjugateGradient(void Ax(float *Product, float *x, void *Pass), float *b, int n, bool OkToModify_b = true, float *x = nullptr, float RMSResidual = 0.0f, void *Pass = nullptr, int MaximumIterates = 0, void Preconditioner(float *Product, float *x, void *Pass) = nullptr);
@@ -154,8 +155,15 @@ public:
     In place calculation to save memory (Source == Compressed) is totally ok. Reweightings > 0 invokes CreateIteratedBlur instead of CreateBlur. */
     void CompressDynamicRange(float *Source, float Scale = 1.0f, float EdgeStopping = 1.4f, float CompressionExponent = 0.8f, float DetailBoost = 0.1f, int Iterates = 20, int Reweightings = 0);
 
+    //The reweightings stop early when the token is cancelled, leaving an unfinished blur.
+    void setCancelToken(const rtengine::CancelToken *token)
+    {
+        cancelToken = token;
+    }
+
 private:
     MultiDiagonalSymmetricMatrix *A;    //The equations are simple enough to not mandate a matrix class, but fast solution NEEDS a complicated preconditioner.
+    const rtengine::CancelToken *cancelToken;    //Polled between the reweightings, nullptr when not cancellable.
     int w, h, n;
 
     //Convenient access to the data in A.
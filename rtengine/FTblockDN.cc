@@ -38,6 +38,7 @@
 #include "cplx_wavelet_dec.h"
 #include "median.h"
 #include "iccstore.h"
+#include "memorybudget.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -49,6 +50,9 @@
 
 #define epsilon 0.001f/(TS*TS) //tolerance
 
+#define denoiseBytesPerPixel 64 // rough upper bound of the memory used per pixel of a tile: Lab copy, wavelet decompositions, noise variance maps
+#define minDenoiseTileSize 256
+
 namespace rtengine
 {
 
@@ -647,6 +651,39 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
             overlap = 96;
         }
 
+        // choose the tiling from the memory budget up front, instead of waiting for an allocation to fail
+        const size_t availableMemory = MemoryBudget::getInstance().getAvailable();
+        bool untiledFirst = options.rgbDenoiseThreadLimit == 0 && !ponder;
+
+        if (untiledFirst && size_t(imwidth) * imheight * denoiseBytesPerPixel > availableMemory) {
+            untiledFirst = false;
+        }
+
+        if (!untiledFirst && availableMemory != SIZE_MAX) {
+#ifdef _OPENMP
+            size_t maxThreads = omp_get_max_threads();
+
+            if (options.rgbDenoiseThreadLimit > 0) {
+                maxThreads = MIN(maxThreads, size_t(options.rgbDenoiseThreadLimit));
+            }
+
+#else
+            size_t maxThreads = 1;
+#endif
+            // the tiled pass also needs an output buffer of the size of the image
+            const size_t outputSize = size_t(imwidth) * imheight * 3 * sizeof(float);
+            const size_t tileMemory = availableMemory > outputSize ? (availableMemory - outputSize) / maxThreads : 0;
+
+            while (tilesize > minDenoiseTileSize && size_t(tilesize) * tilesize * denoiseBytesPerPixel > tileMemory) {
+                tilesize -= 128;
+                overlap = tilesize / 8;
+            }
+
+            if (settings->verbose) {
+                printf("Denoise tile size chosen from the memory budget: %d\n", tilesize);
+            }
+        }
+
         int numTries = 0;
 
         if (ponder) {
@@ -664,7 +701,7 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
 
             int numtiles_W, numtiles_H, tilewidth, tileheight, tileWskip, tileHskip;
 
-            Tile_calc (tilesize, overlap, (options.rgbDenoiseThreadLimit == 0 && !ponder) ? (numTries == 1 ? 0 : 2) : 2, imwidth, imheight, numtiles_W, numtiles_H, tilewidth, tileheight, tileWskip, tileHskip);
+            Tile_calc (tilesize, overlap, untiledFirst ? (numTries == 1 ? 0 : 2) : 2, imwidth, imheight, numtiles_W, numtiles_H, tilewidth, tileheight, tileWskip, tileHskip);
             memoryAllocationFailed = false;
             const int numtiles = numtiles_W * numtiles_H;
 
@@ -803,6 +840,10 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
 
                 for (int tiletop = 0; tiletop < imheight; tiletop += tileHskip) {
                     for (int tileleft = 0; tileleft < imwidth ; tileleft += tileWskip) {
+                        if (isCancelled()) {
+                            continue;
+                        }
+
                         //printf("titop=%d tileft=%d\n",tiletop/tileHskip, tileleft/tileWskip);
                         pos = (tiletop / tileHskip) * numtiles_W + tileleft / tileWskip ;
                         int tileright = MIN(imwidth, tileleft + tilewidth);
@@ -1381,6 +1422,9 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
 #endif
 
                                     for (int vblk = 0; vblk < numblox_H; ++vblk) {
+                                        if (isCancelled()) {
+                                            continue;
+                                        }
 
                                         int top = (vblk - blkrad) * offset;
                                         float * datarow = pBuf + blkrad * offset;
@@ -1734,7 +1778,7 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
                 fftwf_destroy_plan(plan_backward_blox[1]);
                 fftwf_cleanup();
             }
-        } while(memoryAllocationFailed && numTries < 2 && (options.rgbDenoiseThreadLimit == 0) && !ponder);
+        } while(memoryAllocationFailed && numTries < 2 && untiledFirst);
 
         if (memoryAllocationFailed) {
             printf("tiled denoise failed due to isufficient memory. Output is not denoised!\n");
@@ -24,6 +24,7 @@
 #include <utility>
 #include <glibmm.h>
 #include "../rtgui/threadutils.h"
+#include "bufferpool.h"
 
 // Aligned buffer that should be faster
 template <class T> class AlignedBuffer
@@ -34,6 +35,42 @@ private:
     char alignment;
     size_t allocatedSize;
     int unitSize;
+    bool pooled;
+
+    bool resizePooled(size_t size, int structSize)
+    {
+        const size_t newSize = size * (structSize ? structSize : sizeof(T));
+
+        if (newSize == allocatedSize) {
+            return true;
+        }
+
+        if (real) {
+            rtengine::BufferPool::getInstance().release(real, allocatedSize);
+        }
+
+        real = nullptr;
+        data = nullptr;
+        inUse = false;
+        allocatedSize = 0;
+        unitSize = 0;
+
+        if (!size) {
+            return true;
+        }
+
+        real = rtengine::BufferPool::getInstance().acquire(newSize);
+
+        if (!real) {
+            return false;
+        }
+
+        data = (T*)real;
+        inUse = true;
+        allocatedSize = newSize;
+        unitSize = structSize ? structSize : sizeof(T);
+        return true;
+    }
 
 public:
     T* data ;
@@ -42,8 +79,9 @@ public:
     /** @brief Allocate aligned memory
     * @param size Number of elements of size T to allocate, i.e. allocated size will be sizeof(T)*size ; set it to 0 if you want to defer the allocation
     * @param align Expressed in bytes; SSE instructions need 128 bits alignment, which mean 16 bytes, which is the default value
+    * @param pool If true, the memory is drawn from and returned to the BufferPool, and is 64 bytes aligned whatever "align" is
     */
-    AlignedBuffer (size_t size = 0, size_t align = 16) : real(nullptr), alignment(align), allocatedSize(0), unitSize(0), data(nullptr), inUse(false)
+    AlignedBuffer (size_t size = 0, size_t align = 16, bool pool = false) : real(nullptr), alignment(align), allocatedSize(0), unitSize(0), pooled(pool), data(nullptr), inUse(false)
     {
         if (size) {
             resize(size);
@@ -53,7 +91,11 @@ public:
     ~AlignedBuffer ()
     {
         if (real) {
-            free(real);
+            if (pooled) {
+                rtengine::BufferPool::getInstance().release(real, allocatedSize);
+            } else {
+                free(real);
+            }
         }
     }
 
@@ -71,6 +113,10 @@ public:
     */
     bool resize(size_t size, int structSize = 0)
     {
+        if (pooled) {
+            return resizePooled(size, structSize);
+        }
+
         if (allocatedSize != size) {
             if (!size) {
                 // The user want to free the memory
@@ -132,6 +178,8 @@ public:
         std::swap(real, other.real);
         std::swap(alignment, other.alignment);
         std::swap(allocatedSize, other.allocatedSize);
+        std::swap(unitSize, other.unitSize);
+        std::swap(pooled, other.pooled);
         std::swap(data, other.data);
         std::swap(inUse, other.inUse);
     }
@@ -34,11 +34,42 @@
 #include "opthelper.h"
 #include "median.h"
 #include "StopWatch.h"
+#include "cpudispatch.h"
 
 namespace rtengine
 {
 
-SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw, int winh, array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
+#ifdef CPU_DISPATCH
+namespace
+{
+
+// the wide row kernels and their helpers, compiled for AVX2 and AVX-512 whatever the version of amaze_demosaic_RT calling them
+#pragma GCC push_options
+#pragma GCC target ("avx2")
+namespace avx2
+{
+#include "vfloatwide.h"
+typedef vfloat8 vfloatw;
+typedef vmask8 vmaskw;
+#include "amaze_wide.h"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target ("avx512f")
+namespace avx512
+{
+#include "vfloatwide.h"
+typedef vfloat16 vfloatw;
+typedef vmask16 vmaskw;
+#include "amaze_wide.h"
+}
+#pragma GCC pop_options
+
+}
+#endif
+
+SSEFUNCTION MULTIVERSION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw, int winh, array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue)
 {
     BENCHFUN
 
@@ -113,6 +144,11 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
         float v;
     } s_hv;
 
+#ifdef CPU_DISPATCH
+    // 16 in the AVX-512 version of this function, 8 in the AVX2 version, 4 otherwise
+    const int simdWidth = getDispatchedSimdWidth();
+#endif
+
 #ifdef _OPENMP
     #pragma omp parallel
 #endif
@@ -334,7 +370,14 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
                 vfloat epsv = F2V( eps );
 
                 for (int rr = 2; rr < rr1 - 2; rr++) {
-                    for (int indx = rr * ts; indx < rr * ts + cc1; indx += 4) {
+                    int indx = rr * ts;
+#ifdef CPU_DISPATCH
+                    indx = simdWidth == 16 ? avx512::amazeGradients<ts>(indx, rr * ts + cc1, cfa, dirwts0, dirwts1, delhvsqsum, eps)
+                         : simdWidth == 8 ? avx2::amazeGradients<ts>(indx, rr * ts + cc1, cfa, dirwts0, dirwts1, delhvsqsum, eps)
+                         : indx;
+#endif
+
+                    for (; indx < rr * ts + cc1; indx += 4) {
                         vfloat delhv = vabsf( LVFU( cfa[indx + 1] ) -  LVFU( cfa[indx - 1] ) );
                         vfloat delvv = vabsf( LVF( cfa[indx + v1] ) -  LVF( cfa[indx - v1] ) );
                         STVF(dirwts1[indx], epsv + vabsf( LVFU( cfa[indx + 2] ) - LVF( cfa[indx] )) + vabsf( LVF( cfa[indx] ) - LVFU( cfa[indx - 2] )) + delhv );
@@ -373,8 +416,14 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
 
                 for (int rr = 4; rr < rr1 - 4; rr++) {
                     sgnv = -sgnv;
+                    int indx = rr * ts + 4;
+#ifdef CPU_DISPATCH
+                    indx = simdWidth == 16 ? avx512::amazeColourDiffs<ts>(indx, rr * ts + cc1 - 7, sgnv[0], sgnv[1], cfa, dirwts0, dirwts1, vcd, hcd, vcdalt, hcdalt, dgintv, dginth, eps, arthresh, clip_pt8)
+                         : simdWidth == 8 ? avx2::amazeColourDiffs<ts>(indx, rr * ts + cc1 - 7, sgnv[0], sgnv[1], cfa, dirwts0, dirwts1, vcd, hcd, vcdalt, hcdalt, dgintv, dginth, eps, arthresh, clip_pt8)
+                         : indx;
+#endif
 
-                    for (int indx = rr * ts + 4; indx < rr * ts + cc1 - 7; indx += 4) {
+                    for (; indx < rr * ts + cc1 - 7; indx += 4) {
                         //colour ratios in each cardinal direction
                         vfloat cfav = LVF(cfa[indx]);
                         vfloat cruv = LVF(cfa[indx - v1]) * (LVF(dirwts0[indx - v2]) + LVF(dirwts0[indx])) / (LVF(dirwts0[indx - v2]) * (epsv + cfav) + LVF(dirwts0[indx]) * (epsv + LVF(cfa[indx - v2])));
@@ -673,7 +722,14 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
                 vfloat  epssqv = F2V( epssq );
 
                 for (int rr = 6; rr < rr1 - 6; rr++) {
-                    for (int indx = rr * ts + 6 + (FC(rr, 2) & 1); indx < rr * ts + cc1 - 6; indx += 8) {
+                    int indx = rr * ts + 6 + (FC(rr, 2) & 1);
+#ifdef CPU_DISPATCH
+                    indx = simdWidth == 16 ? avx512::amazeInterpolationWeights<ts>(indx, rr * ts + cc1 - 6, vcd, hcd, dirwts0, dirwts1, dgintv, dginth, hvwt, epssq)
+                         : simdWidth == 8 ? avx2::amazeInterpolationWeights<ts>(indx, rr * ts + cc1 - 6, vcd, hcd, dirwts0, dirwts1, dgintv, dginth, hvwt, epssq)
+                         : indx;
+#endif
+
+                    for (; indx < rr * ts + cc1 - 6; indx += 8) {
                         //compute colour difference variances in cardinal directions
                         vfloat tempv = LC2VFU(vcd[indx]);
                         vfloat uavev = tempv + LC2VFU(vcd[indx - v1]) + LC2VFU(vcd[indx - v2]) + LC2VFU(vcd[indx - v3]);
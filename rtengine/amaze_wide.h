@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////
+//
+//  Wide row kernels of amaze_demosaic_RT
+//
+//  No include guard: amaze_demosaic_RT.cc includes this file once per instruction set, in a namespace defining
+//  vfloatw and vmaskw and under the matching "#pragma GCC target", so that the kernels are compiled for it
+//  whatever the target of the translation unit.
+//
+//  Each kernel is the vfloatw wide version of one of the full resolution loops of the green interpolation. It handles
+//  a row from indx on, as long as a whole vector fits in what the 4 wide loop would handle, and returns the index where
+//  the 4 wide loop has to continue. Same operations in the same order as the 4 wide loops, hence same results up to
+//  the rounding of the fused multiply-adds of the AVX-512 version.
+//  The loop bounding the colour differences is left 4 wide: it updates hcd in place and reads hcd[indx - 2], so its
+//  results depend on the width.
+//
+//  this is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////
+
+// horizontal and vertical gradients
+template<int ts>
+int amazeGradients(int indx, int end, const float* cfa, float* dirwts0, float* dirwts1, float* delhvsqsum, float eps)
+{
+    constexpr int w = VectorTraits<vfloatw>::width;
+    constexpr int v1 = ts, v2 = 2 * ts;
+    const vfloatw epsv = F2VN<vfloatw>(eps);
+
+    for (; indx + w - 4 < end; indx += w) {
+        vfloatw delhv = vabsfn( LVFUN<vfloatw>( cfa[indx + 1] ) -  LVFUN<vfloatw>( cfa[indx - 1] ) );
+        vfloatw delvv = vabsfn( LVFUN<vfloatw>( cfa[indx + v1] ) -  LVFUN<vfloatw>( cfa[indx - v1] ) );
+        STVFUN(dirwts1[indx], epsv + vabsfn( LVFUN<vfloatw>( cfa[indx + 2] ) - LVFUN<vfloatw>( cfa[indx] )) + vabsfn( LVFUN<vfloatw>( cfa[indx] ) - LVFUN<vfloatw>( cfa[indx - 2] )) + delhv );
+        STVFUN(dirwts0[indx], epsv + vabsfn( LVFUN<vfloatw>( cfa[indx + v2] ) - LVFUN<vfloatw>( cfa[indx] )) + vabsfn( LVFUN<vfloatw>( cfa[indx] ) - LVFUN<vfloatw>( cfa[indx - v2] )) + delvv );
+        STVFUN(delhvsqsum[indx], SQRVN(delhv) + SQRVN(delvv));
+    }
+
+    return indx;
+}
+
+// vertical and horizontal colour differences, sgnEven and sgnOdd are the signs of the even and odd columns of the row
+template<int ts>
+int amazeColourDiffs(int indx, int end, float sgnEven, float sgnOdd, const float* cfa, const float* dirwts0, const float* dirwts1,
+                     float* vcd, float* hcd, float* vcdalt, float* hcdalt, float* dgintv, float* dginth, float eps, float arthresh, float clip_pt8)
+{
+    constexpr int w = VectorTraits<vfloatw>::width;
+    constexpr int v1 = ts, v2 = 2 * ts;
+    const vfloatw sgnv = F2VN<vfloatw>(sgnEven, sgnOdd);
+    const vfloatw epsv = F2VN<vfloatw>(eps);
+    const vfloatw zd5v = F2VN<vfloatw>(0.5f);
+    const vfloatw onev = F2VN<vfloatw>(1.f);
+    const vfloatw arthreshv = F2VN<vfloatw>(arthresh);
+    const vfloatw clip_pt8v = F2VN<vfloatw>(clip_pt8);
+
+    for (; indx + w - 4 < end; indx += w) {
+        //colour ratios in each cardinal direction
+        vfloatw cfav = LVFUN<vfloatw>(cfa[indx]);
+        vfloatw cruv = LVFUN<vfloatw>(cfa[indx - v1]) * (LVFUN<vfloatw>(dirwts0[indx - v2]) + LVFUN<vfloatw>(dirwts0[indx])) / (LVFUN<vfloatw>(dirwts0[indx - v2]) * (epsv + cfav) + LVFUN<vfloatw>(dirwts0[indx]) * (epsv + LVFUN<vfloatw>(cfa[indx - v2])));
+        vfloatw crdv = LVFUN<vfloatw>(cfa[indx + v1]) * (LVFUN<vfloatw>(dirwts0[indx + v2]) + LVFUN<vfloatw>(dirwts0[indx])) / (LVFUN<vfloatw>(dirwts0[indx + v2]) * (epsv + cfav) + LVFUN<vfloatw>(dirwts0[indx]) * (epsv + LVFUN<vfloatw>(cfa[indx + v2])));
+        vfloatw crlv = LVFUN<vfloatw>(cfa[indx - 1]) * (LVFUN<vfloatw>(dirwts1[indx - 2]) + LVFUN<vfloatw>(dirwts1[indx])) / (LVFUN<vfloatw>(dirwts1[indx - 2]) * (epsv + cfav) + LVFUN<vfloatw>(dirwts1[indx]) * (epsv + LVFUN<vfloatw>(cfa[indx - 2])));
+        vfloatw crrv = LVFUN<vfloatw>(cfa[indx + 1]) * (LVFUN<vfloatw>(dirwts1[indx + 2]) + LVFUN<vfloatw>(dirwts1[indx])) / (LVFUN<vfloatw>(dirwts1[indx + 2]) * (epsv + cfav) + LVFUN<vfloatw>(dirwts1[indx]) * (epsv + LVFUN<vfloatw>(cfa[indx + 2])));
+
+        //G interpolated in vert/hor directions using Hamilton-Adams method
+        vfloatw guhav = LVFUN<vfloatw>(cfa[indx - v1]) + zd5v * (cfav - LVFUN<vfloatw>(cfa[indx - v2]));
+        vfloatw gdhav = LVFUN<vfloatw>(cfa[indx + v1]) + zd5v * (cfav - LVFUN<vfloatw>(cfa[indx + v2]));
+        vfloatw glhav = LVFUN<vfloatw>(cfa[indx - 1]) + zd5v * (cfav - LVFUN<vfloatw>(cfa[indx - 2]));
+        vfloatw grhav = LVFUN<vfloatw>(cfa[indx + 1]) + zd5v * (cfav - LVFUN<vfloatw>(cfa[indx + 2]));
+
+        //G interpolated in vert/hor directions using adaptive ratios
+        vfloatw guarv = vselfn(vabsfn(onev - cruv) < arthreshv, cfav * cruv, guhav);
+        vfloatw gdarv = vselfn(vabsfn(onev - crdv) < arthreshv, cfav * crdv, gdhav);
+        vfloatw glarv = vselfn(vabsfn(onev - crlv) < arthreshv, cfav * crlv, glhav);
+        vfloatw grarv = vselfn(vabsfn(onev - crrv) < arthreshv, cfav * crrv, grhav);
+
+        //adaptive weights for vertical/horizontal directions
+        vfloatw hwtv = LVFUN<vfloatw>(dirwts1[indx - 1]) / (LVFUN<vfloatw>(dirwts1[indx - 1]) + LVFUN<vfloatw>(dirwts1[indx + 1]));
+        vfloatw vwtv = LVFUN<vfloatw>(dirwts0[indx - v1]) / (LVFUN<vfloatw>(dirwts0[indx + v1]) + LVFUN<vfloatw>(dirwts0[indx - v1]));
+
+        //interpolated G via adaptive weights of cardinal evaluations
+        vfloatw Ginthhav = vintpfn(hwtv, grhav, glhav);
+        vfloatw Gintvhav = vintpfn(vwtv, gdhav, guhav);
+
+        //interpolated colour differences
+        vfloatw hcdaltv = sgnv * (Ginthhav - cfav);
+        vfloatw vcdaltv = sgnv * (Gintvhav - cfav);
+        STVFUN(hcdalt[indx], hcdaltv);
+        STVFUN(vcdalt[indx], vcdaltv);
+
+        vmaskw clipmask = (cfav > clip_pt8v) | (Gintvhav > clip_pt8v) | (Ginthhav > clip_pt8v);
+        guarv = vselfn( clipmask, guhav, guarv);
+        gdarv = vselfn( clipmask, gdhav, gdarv);
+        glarv = vselfn( clipmask, glhav, glarv);
+        grarv = vselfn( clipmask, grhav, grarv);
+
+        //use HA if highlights are (nearly) clipped
+        STVFUN(vcd[indx], vselfn( clipmask, vcdaltv, sgnv * (vintpfn(vwtv, gdarv, guarv) - cfav)));
+        STVFUN(hcd[indx], vselfn( clipmask, hcdaltv, sgnv * (vintpfn(hwtv, grarv, glarv) - cfav)));
+
+        //differences of interpolations in opposite directions
+        STVFUN(dgintv[indx], vminfn(SQRVN(guhav - gdhav), SQRVN(guarv - gdarv)));
+        STVFUN(dginth[indx], vminfn(SQRVN(glhav - grhav), SQRVN(glarv - grarv)));
+    }
+
+    return indx;
+}
+
+// adaptive weights for the G interpolation, written at half resolution: indx advances by 2 * width
+template<int ts>
+int amazeInterpolationWeights(int indx, int end, const float* vcd, const float* hcd, const float* dirwts0, const float* dirwts1,
+                              const float* dgintv, const float* dginth, float* hvwt, float epssq)
+{
+    constexpr int w = VectorTraits<vfloatw>::width;
+    constexpr int v1 = ts, v2 = 2 * ts, v3 = 3 * ts;
+    const vfloatw epssqv = F2VN<vfloatw>(epssq);
+    const vfloatw zd5v = F2VN<vfloatw>(0.5f);
+    const vfloatw zerov = F2VN<vfloatw>(0.f);
+
+    for (; indx + 2 * w - 8 < end; indx += 2 * w) {
+        //compute colour difference variances in cardinal directions
+        vfloatw tempv = LC2VFUN<vfloatw>(vcd[indx]);
+        vfloatw uavev = tempv + LC2VFUN<vfloatw>(vcd[indx - v1]) + LC2VFUN<vfloatw>(vcd[indx - v2]) + LC2VFUN<vfloatw>(vcd[indx - v3]);
+        vfloatw davev = tempv + LC2VFUN<vfloatw>(vcd[indx + v1]) + LC2VFUN<vfloatw>(vcd[indx + v2]) + LC2VFUN<vfloatw>(vcd[indx + v3]);
+        vfloatw Dgrbvvaruv = SQRVN(tempv - uavev) + SQRVN(LC2VFUN<vfloatw>(vcd[indx - v1]) - uavev) + SQRVN(LC2VFUN<vfloatw>(vcd[indx - v2]) - uavev) + SQRVN(LC2VFUN<vfloatw>(vcd[indx - v3]) - uavev);
+        vfloatw Dgrbvvardv = SQRVN(tempv - davev) + SQRVN(LC2VFUN<vfloatw>(vcd[indx + v1]) - davev) + SQRVN(LC2VFUN<vfloatw>(vcd[indx + v2]) - davev) + SQRVN(LC2VFUN<vfloatw>(vcd[indx + v3]) - davev);
+
+        vfloatw hwtv = vadivapbn(LC2VFUN<vfloatw>(dirwts1[indx - 1]), LC2VFUN<vfloatw>(dirwts1[indx + 1]));
+        vfloatw vwtv = vadivapbn(LC2VFUN<vfloatw>(dirwts0[indx - v1]), LC2VFUN<vfloatw>(dirwts0[indx + v1]));
+
+        tempv = LC2VFUN<vfloatw>(hcd[indx]);
+        vfloatw lavev = tempv + vaddc2vfun<vfloatw>(hcd[indx - 3]) + LC2VFUN<vfloatw>(hcd[indx - 1]);
+        vfloatw ravev = tempv + vaddc2vfun<vfloatw>(hcd[indx + 1]) + LC2VFUN<vfloatw>(hcd[indx + 3]);
+
+        vfloatw Dgrbhvarlv = SQRVN(tempv - lavev) + SQRVN(LC2VFUN<vfloatw>(hcd[indx - 1]) - lavev) + SQRVN(LC2VFUN<vfloatw>(hcd[indx - 2]) - lavev) + SQRVN(LC2VFUN<vfloatw>(hcd[indx - 3]) - lavev);
+        vfloatw Dgrbhvarrv = SQRVN(tempv - ravev) + SQRVN(LC2VFUN<vfloatw>(hcd[indx + 1]) - ravev) + SQRVN(LC2VFUN<vfloatw>(hcd[indx + 2]) - ravev) + SQRVN(LC2VFUN<vfloatw>(hcd[indx + 3]) - ravev);
+
+        vfloatw vcdvarv = epssqv + vintpfn(vwtv, Dgrbvvardv, Dgrbvvaruv);
+        vfloatw hcdvarv = epssqv + vintpfn(hwtv, Dgrbhvarrv, Dgrbhvarlv);
+
+        //compute fluctuations in up/down and left/right interpolations of colours
+        Dgrbvvaruv = LC2VFUN<vfloatw>(dgintv[indx - v1]) + LC2VFUN<vfloatw>(dgintv[indx - v2]);
+        Dgrbvvardv = LC2VFUN<vfloatw>(dgintv[indx + v1]) + LC2VFUN<vfloatw>(dgintv[indx + v2]);
+
+        Dgrbhvarlv = vaddc2vfun<vfloatw>(dginth[indx - 2]);
+        Dgrbhvarrv = vaddc2vfun<vfloatw>(dginth[indx + 1]);
+
+        vfloatw vcdvar1v = epssqv + LC2VFUN<vfloatw>(dgintv[indx]) + vintpfn(vwtv, Dgrbvvardv, Dgrbvvaruv);
+        vfloatw hcdvar1v = epssqv + LC2VFUN<vfloatw>(dginth[indx]) + vintpfn(hwtv, Dgrbhvarrv, Dgrbhvarlv);
+
+        //determine adaptive weights for G interpolation
+        vfloatw varwtv = hcdvarv / (vcdvarv + hcdvarv);
+        vfloatw diffwtv = hcdvar1v / (vcdvar1v + hcdvar1v);
+
+        //if both agree on interpolation direction, choose the one with strongest directional discrimination;
+        //otherwise, choose the u/d and l/r difference fluctuation weights
+        vmaskw decmask = ((zd5v - varwtv) * (zd5v - diffwtv) > zerov) & (vabsfn( zd5v - diffwtv) < vabsfn( zd5v - varwtv));
+        STVFUN(hvwt[indx >> 1], vselfn( decmask, varwtv, diffwtv));
+    }
+
+    return indx;
+}
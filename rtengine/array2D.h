@@ -66,6 +66,10 @@
 #include <cstring>
 #include <cstdio>
 
+#include <new>
+
+#include "bufferpool.h"
+#include "memorybudget.h"
 #include "noncopyable.h"
 
 template<typename T>
@@ -79,6 +83,34 @@ private:
     T ** ptr;
     T * data;
     bool lock; // useful lock to ensure data is not changed anymore.
+    size_t budgetSize; // bytes of data accounted in the MemoryBudget
+    void budgetAllocated(size_t size)
+    {
+        budgetSize = size * sizeof(T);
+        rtengine::MemoryBudget::getInstance().allocated(budgetSize);
+    }
+    void budgetReleased()
+    {
+        rtengine::MemoryBudget::getInstance().released(budgetSize);
+        budgetSize = 0;
+    }
+    // data is drawn from the BufferPool, so that the large temporary arrays of the kernels are reused from job to job
+    T* allocData(size_t size)
+    {
+        T* newData = static_cast<T*>(rtengine::BufferPool::getInstance().acquire(size * sizeof(T)));
+
+        if (!newData) {
+            throw std::bad_alloc();
+        }
+
+        budgetAllocated(size);
+        return newData;
+    }
+    void freeData()
+    {
+        rtengine::BufferPool::getInstance().release(data, budgetSize);
+        budgetReleased();
+    }
     void ar_realloc(int w, int h, int offset = 0)
     {
         if ((ptr) && ((h > y) || (4 * h < y))) {
@@ -87,7 +119,7 @@ private:
         }
 
         if ((data) && (((h * w) > (x * y)) || ((h * w) < ((x * y) / 4)))) {
-            delete[] data;
+            freeData();
             data = nullptr;
         }
 
@@ -96,7 +128,7 @@ private:
         }
 
         if (data == nullptr) {
-            data = new T[h * w + offset];
+            data = allocData(h * w + offset);
         }
 
         x = w;
@@ -113,7 +145,7 @@ public:
     // use as empty declaration, resize before use!
     // very useful as a member object
     array2D() :
-        x(0), y(0), owner(0), flags(0), ptr(nullptr), data(nullptr), lock(false)
+        x(0), y(0), owner(0), flags(0), ptr(nullptr), data(nullptr), lock(false), budgetSize(0)
     {
         //printf("got empty array2D init\n");
     }
@@ -123,7 +155,7 @@ public:
     {
         flags = flgs;
         lock = flags & ARRAY2D_LOCK_DATA;
-        data = new T[h * w];
+        data = allocData(h * w);
         owner = 1;
         x = w;
         y = h;
@@ -149,9 +181,10 @@ public:
         owner = (flags & ARRAY2D_BYREFERENCE) ? 0 : 1;
 
         if (owner) {
-            data = new T[h * w];
+            data = allocData(h * w);
         } else {
             data = nullptr;
+            budgetSize = 0;
         }
 
         x = w;
@@ -180,7 +213,7 @@ public:
         }
 
         if ((owner) && (data)) {
-            delete[] data;
+            freeData();
         }
 
         if (ptr) {
@@ -191,7 +224,7 @@ public:
     void free()
     {
         if ((owner) && (data)) {
-            delete[] data;
+            freeData();
             data = nullptr;
         }
 
@@ -0,0 +1,205 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bufferpool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "memorybudget.h"
+#include "settings.h"
+
+namespace rtengine
+{
+
+extern const Settings* settings;
+
+const std::chrono::seconds BufferPool::maxIdleTime (30);
+
+BufferPool& BufferPool::getInstance ()
+{
+    static BufferPool instance;
+    return instance;
+}
+
+BufferPool::BufferPool () :
+    retainedBytes (0),
+    hits (0),
+    misses (0)
+{
+    // the budget is constructed first, so that it is destroyed after the pool, whose destructor releases the retained
+    // buffers from it
+    MemoryBudget::getInstance ();
+}
+
+BufferPool::~BufferPool ()
+{
+    trim ();
+}
+
+std::size_t BufferPool::getSizeClass (std::size_t bytes)
+{
+    if (bytes < minPooledSize) {
+        return bytes;
+    }
+
+    // round up to the next multiple of 1/8 of the highest power of two <= bytes
+    std::size_t step = minPooledSize;
+
+    while (step <= bytes / 2) {
+        step *= 2;
+    }
+
+    step /= 8;
+    return (bytes + step - 1) / step * step;
+}
+
+void* BufferPool::allocate (std::size_t bytes)
+{
+    // the address of the malloc'ed block is stored just before the aligned buffer
+    void* real = malloc (bytes + 64 + sizeof (void*));
+
+    if (!real) {
+        return nullptr;
+    }
+
+    void** buffer = reinterpret_cast<void**> ((reinterpret_cast<uintptr_t> (real) + sizeof (void*) + 63) / 64 * 64);
+    buffer[-1] = real;
+    return buffer;
+}
+
+void BufferPool::deallocate (void* buffer)
+{
+    free (static_cast<void**> (buffer)[-1]);
+}
+
+void* BufferPool::acquire (std::size_t bytes)
+{
+    const std::size_t size = getSizeClass (bytes);
+
+    if (size >= minPooledSize) {
+        MyMutex::MyLock lock (mutex);
+
+        trimIdle ();
+
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+            if (entry->size == size) {
+                void* buffer = entry->buffer;
+                retainedBytes -= size;
+                // the caller accounts the buffer from now on
+                MemoryBudget::getInstance().released (size);
+                entries.erase (entry);
+                ++hits;
+                return buffer;
+            }
+        }
+
+        ++misses;
+
+        // make room in the budget for the new buffer
+        const std::size_t available = MemoryBudget::getInstance().getAvailable();
+
+        if (available < size) {
+            trimTo (retainedBytes > size - available ? retainedBytes - (size - available) : 0);
+        }
+    }
+
+    void* buffer = allocate (size);
+
+    if (!buffer && size >= minPooledSize) {
+        // the retained buffers may be what's missing
+        trim ();
+        buffer = allocate (size);
+    }
+
+    return buffer;
+}
+
+void BufferPool::release (void* buffer, std::size_t bytes)
+{
+    if (!buffer) {
+        return;
+    }
+
+    const std::size_t size = getSizeClass (bytes);
+    const std::size_t maxRetained = settings ? std::size_t (std::max (settings->bufferPoolSize, 0)) << 20 : 0;
+
+    if (size < minPooledSize || size > maxRetained) {
+        deallocate (buffer);
+        return;
+    }
+
+    MyMutex::MyLock lock (mutex);
+
+    entries.push_front ({size, buffer, Clock::now()});
+    retainedBytes += size;
+    MemoryBudget::getInstance().allocated (size);
+
+    trimIdle ();
+    trimTo (maxRetained);
+}
+
+void BufferPool::trim ()
+{
+    MyMutex::MyLock lock (mutex);
+
+    trimTo (0);
+}
+
+void BufferPool::trimIdle ()
+{
+    const Clock::time_point limit = Clock::now() - maxIdleTime;
+
+    while (!entries.empty() && entries.back().released < limit) {
+        retainedBytes -= entries.back().size;
+        MemoryBudget::getInstance().released (entries.back().size);
+        deallocate (entries.back().buffer);
+        entries.pop_back ();
+    }
+}
+
+void BufferPool::trimTo (std::size_t bytes)
+{
+    while (retainedBytes > bytes) {
+        retainedBytes -= entries.back().size;
+        MemoryBudget::getInstance().released (entries.back().size);
+        deallocate (entries.back().buffer);
+        entries.pop_back ();
+    }
+}
+
+BufferPool::Stats BufferPool::getStats () const
+{
+    MyMutex::MyLock lock (mutex);
+
+    return {hits, misses, entries.size(), retainedBytes};
+}
+
+void BufferPool::reportStats () const
+{
+    if (settings && settings->verbose) {
+        const Stats stats = getStats ();
+        const std::size_t requests = stats.hits + stats.misses;
+
+        printf ("Buffer pool: %zu hits / %zu requests (%.0f%%), %zu buffers retained (%zu MB)\n", stats.hits, requests,
+                requests ? 100.0 * stats.hits / requests : 0.0, stats.retainedBuffers, stats.retainedBytes >> 20);
+    }
+}
+
+}
@@ -0,0 +1,98 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+
+#include "noncopyable.h"
+#include "../rtgui/threadutils.h"
+
+namespace rtengine
+{
+
+/**
+  * Thread safe pool of the large buffers holding image planes.
+  *
+  * Released buffers of 1 MB and more are kept and handed out again to a later request of the same size class
+  * (sizes are rounded up by at most 1/8), which avoids the allocator churn and the page faults on first touch
+  * of the pipelines allocating the same image sizes over and over. Smaller buffers go straight to malloc.
+  *
+  * Trim policy: the retained buffers are freed, oldest first, when they exceed the pool size setting, and
+  * when they haven't been reused for maxIdleTime. trim() frees all of them.
+  *
+  * The retained buffers stay resident, so they are accounted in the MemoryBudget like the buffers in use, and
+  * are freed when a new buffer wouldn't fit in the budget otherwise.
+  *
+  * All buffers are 64 bytes aligned.
+  */
+class BufferPool final :
+    public NonCopyable
+{
+public:
+    struct Stats {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t retainedBuffers;
+        std::size_t retainedBytes;
+    };
+
+    static BufferPool& getInstance ();
+
+    ~BufferPool ();
+
+    void* acquire (std::size_t bytes);
+    /// bytes must be the size asked to acquire()
+    void release (void* buffer, std::size_t bytes);
+
+    void trim ();
+
+    Stats getStats () const;
+    /// Prints the statistics in verbose mode
+    void reportStats () const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::size_t size;
+        void* buffer;
+        Clock::time_point released;
+    };
+
+    static constexpr std::size_t minPooledSize = 1 << 20;
+    static const std::chrono::seconds maxIdleTime;
+
+    BufferPool ();
+
+    static std::size_t getSizeClass (std::size_t bytes);
+    static void* allocate (std::size_t bytes);
+    static void deallocate (void* buffer);
+
+    void trimIdle ();
+    void trimTo (std::size_t bytes);
+
+    mutable MyMutex mutex;
+    std::list<Entry> entries; // most recently released first
+    std::size_t retainedBytes;
+    std::size_t hits;
+    std::size_t misses;
+};
+
+}
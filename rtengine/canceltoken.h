@@ -0,0 +1,58 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "noncopyable.h"
+
+namespace rtengine
+{
+
+/**
+  * Flag telling a running processing that its result isn't needed anymore.
+  *
+  * The owner of the processing raises it when new parameters arrive, and the heavy kernels poll it
+  * at tile or row-block boundaries to return early. The output of a cancelled kernel is undefined.
+  */
+class CancelToken final :
+    public NonCopyable
+{
+public:
+    CancelToken () : cancelled (false) {}
+
+    void cancel ()
+    {
+        cancelled.store (true, std::memory_order_relaxed);
+    }
+
+    void reset ()
+    {
+        cancelled.store (false, std::memory_order_relaxed);
+    }
+
+    bool isCancelled () const
+    {
+        return cancelled.load (std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> cancelled;
+};
+
+}
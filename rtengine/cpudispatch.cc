@@ -0,0 +1,74 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cpudispatch.h"
+
+namespace rtengine
+{
+
+#ifdef CPU_DISPATCH
+
+// one function per target of MULTIVERSION, the dynamic loader binds one of them like it binds the clones
+__attribute__ ((target ("default"))) int dispatchedSimdWidth ()
+{
+    return 4;
+}
+
+__attribute__ ((target ("avx2"))) int dispatchedSimdWidth ()
+{
+    return 8;
+}
+
+__attribute__ ((target ("avx512f"))) int dispatchedSimdWidth ()
+{
+    return 16;
+}
+
+int getDispatchedSimdWidth ()
+{
+    return dispatchedSimdWidth ();
+}
+
+const char* getDispatchedSimdPath ()
+{
+    switch (dispatchedSimdWidth ()) {
+        case 16:
+            return "AVX-512";
+
+        case 8:
+            return "AVX2";
+
+        default:
+            return "target processor";
+    }
+}
+
+#else
+
+int getDispatchedSimdWidth ()
+{
+    return 4;
+}
+
+const char* getDispatchedSimdPath ()
+{
+    return "target processor (no run time dispatch)";
+}
+
+#endif
+
+}
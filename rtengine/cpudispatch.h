@@ -0,0 +1,34 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+namespace rtengine
+{
+
+/**
+  * The version of the MULTIVERSION kernels bound for the running CPU.
+  *
+  * Both are resolved by the dynamic loader with the same priorities as the target_clones of MULTIVERSION, so
+  * they report the version actually in use instead of re-deriving it from the CPU features.
+  */
+
+/// Floats per vector of the bound version: 16 (AVX-512), 8 (AVX2) or 4 (SSE2 and builds without CPU_DISPATCH)
+int getDispatchedSimdWidth ();
+const char* getDispatchedSimdPath ();
+
+}
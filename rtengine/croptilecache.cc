@@ -0,0 +1,160 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "croptilecache.h"
+#include "image8.h"
+
+namespace rtengine
+{
+
+CropTileCache::CropTileCache () : useCount (0)
+{
+}
+
+void CropTileCache::clear ()
+{
+    tiles.clear ();
+}
+
+int CropTileCache::getMissing (int x1, int y1, int x2, int y2, int imgW, int imgH, int& total, int& mx1, int& my1, int& mx2, int& my2) const
+{
+    total = 0;
+    mx1 = imgW;
+    my1 = imgH;
+    mx2 = my2 = 0;
+    int missing = 0;
+
+    for (int ty = y1 / tileSize; ty * tileSize < y2; ty++) {
+        for (int tx = x1 / tileSize; tx * tileSize < x2; tx++) {
+            total++;
+
+            if (tiles.find (std::make_pair (tx, ty)) == tiles.end ()) {
+                missing++;
+                mx1 = std::min (mx1, tx * tileSize);
+                my1 = std::min (my1, ty * tileSize);
+                mx2 = std::max (mx2, std::min ((tx + 1) * tileSize, imgW));
+                my2 = std::max (my2, std::min ((ty + 1) * tileSize, imgH));
+            }
+        }
+    }
+
+    return missing;
+}
+
+void CropTileCache::put (const Image8* img, const Image8* imgtrue, int x, int y, int vx1, int vy1, int vx2, int vy2, int imgW, int imgH)
+{
+    const int imgWidth = img->getWidth ();
+    vx1 = std::max (vx1, x);
+    vy1 = std::max (vy1, y);
+    vx2 = std::min (vx2, x + imgWidth);
+    vy2 = std::min (vy2, y + img->getHeight ());
+
+    useCount++;
+
+    for (int ty = (vy1 + tileSize - 1) / tileSize; ty * tileSize < vy2; ty++) {
+        for (int tx = (vx1 + tileSize - 1) / tileSize; tx * tileSize < vx2; tx++) {
+            const int tileX = tx * tileSize;
+            const int tileY = ty * tileSize;
+            const int tileW = std::min (tileSize, imgW - tileX);
+            const int tileH = std::min (tileSize, imgH - tileY);
+
+            if (tileX + tileW > vx2 || tileY + tileH > vy2) {
+                // partially valid
+                continue;
+            }
+
+            Tile& tile = tiles[std::make_pair (tx, ty)];
+            tile.width = tileW;
+            tile.height = tileH;
+            tile.lastUse = useCount;
+            tile.data.resize (3 * tileW * tileH);
+            tile.dataTrue.resize (3 * tileW * tileH);
+
+            for (int i = 0; i < tileH; i++) {
+                const size_t offset = 3 * ((size_t)(tileY + i - y) * imgWidth + (tileX - x));
+                memcpy (&tile.data[3 * i * tileW], img->data + offset, 3 * tileW);
+                memcpy (&tile.dataTrue[3 * i * tileW], imgtrue->data + offset, 3 * tileW);
+            }
+        }
+    }
+
+    evict ();
+}
+
+bool CropTileCache::get (int x, int y, Image8* img, Image8* imgtrue)
+{
+    const int imgWidth = img->getWidth ();
+    const int x2 = x + imgWidth;
+    const int y2 = y + img->getHeight ();
+
+    useCount++;
+
+    for (int ty = y / tileSize; ty * tileSize < y2; ty++) {
+        for (int tx = x / tileSize; tx * tileSize < x2; tx++) {
+            auto it = tiles.find (std::make_pair (tx, ty));
+
+            if (it == tiles.end ()) {
+                return false;
+            }
+
+            Tile& tile = it->second;
+            tile.lastUse = useCount;
+
+            // part of the tile inside the area
+            const int tileX = tx * tileSize;
+            const int tileY = ty * tileSize;
+            const int cx1 = std::max (x, tileX);
+            const int cy1 = std::max (y, tileY);
+            const int cx2 = std::min (x2, tileX + tile.width);
+            const int cy2 = std::min (y2, tileY + tile.height);
+
+            for (int i = cy1; i < cy2; i++) {
+                const size_t src = 3 * ((size_t)(i - tileY) * tile.width + (cx1 - tileX));
+                const size_t dst = 3 * ((size_t)(i - y) * imgWidth + (cx1 - x));
+                memcpy (img->data + dst, &tile.data[src], 3 * (cx2 - cx1));
+                memcpy (imgtrue->data + dst, &tile.dataTrue[src], 3 * (cx2 - cx1));
+            }
+        }
+    }
+
+    return true;
+}
+
+void CropTileCache::evict ()
+{
+    // drop the least recently used tiles, keeping the ones used by the last operation
+    while (tiles.size () > maxTiles) {
+        auto oldest = tiles.begin ();
+
+        for (auto it = tiles.begin (); it != tiles.end (); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse) {
+                oldest = it;
+            }
+        }
+
+        if (oldest->second.lastUse == useCount) {
+            break;
+        }
+
+        tiles.erase (oldest);
+    }
+}
+
+}
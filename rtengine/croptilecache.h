@@ -0,0 +1,80 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "noncopyable.h"
+
+namespace rtengine
+{
+
+class Image8;
+
+/**
+  * Cache of the processed tiles of a detail window at 100%.
+  *
+  * The image is split in tileSize x tileSize tiles, aligned on the image origin. The tiles keep the
+  * monitor and the output profile RGB data of the processed image, so that panning the detail window
+  * only needs to process the tiles which weren't seen yet with the current processing parameters.
+  * The cache has to be cleared each time the processing parameters change.
+  */
+class CropTileCache final :
+    public NonCopyable
+{
+public:
+    static constexpr int tileSize = 256;
+    static constexpr size_t maxTiles = 160;   // ~60 MB
+
+    CropTileCache ();
+
+    void clear ();
+
+    /** Counts the tiles covering the (x1, y1)-(x2, y2) area (end excluded) of an imgW x imgH image.
+      * @param total is set to the number of tiles covering the area
+      * @param mx1, my1, mx2, my2 are set to the bounding box of the missing tiles, clipped to the image
+      * @return the number of missing tiles */
+    int getMissing (int x1, int y1, int x2, int y2, int imgW, int imgH, int& total, int& mx1, int& my1, int& mx2, int& my2) const;
+
+    /** Stores the tiles lying completely in the (vx1, vy1)-(vx2, vy2) valid area (end excluded).
+      * @param img is the monitor image, its upper left corner being at (x, y) in the imgW x imgH image
+      * @param imgtrue is the output profile image, of the same size as img */
+    void put (const Image8* img, const Image8* imgtrue, int x, int y, int vx1, int vy1, int vx2, int vy2, int imgW, int imgH);
+
+    /** Copies the tiles to img and imgtrue, their upper left corner being at (x, y) in the image.
+      * @return false if a tile is missing */
+    bool get (int x, int y, Image8* img, Image8* imgtrue);
+
+private:
+    struct Tile {
+        int width;
+        int height;
+        std::vector<unsigned char> data;
+        std::vector<unsigned char> dataTrue;
+        unsigned long lastUse;
+    };
+
+    std::map<std::pair<int, int>, Tile> tiles;
+    unsigned long useCount;
+
+    void evict ();
+};
+
+}
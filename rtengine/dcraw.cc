@@ -259,7 +259,8 @@ void CLASS merror (void *ptr, const char *where)
 
 void CLASS derror()
 {
-  if (!data_error) {
+  /*RT*/ // may be called by several decoding threads, only the first error is reported
+  if (!data_error++) {
     fprintf (stderr, "%s: ", ifname);
     if (feof(ifp))
       fprintf (stderr,_("Unexpected end of file\n"));
@@ -270,7 +271,6 @@ void CLASS derror()
       fprintf (stderr,_("Corrupt data near 0x%llx\n"), (INT64) ftello(ifp));
 #endif
   }
-  data_error++;
 /*RT Issue 2467  longjmp (failure, 1);*/
 }
 
@@ -343,7 +343,12 @@ double CLASS getreal (int type)
 
 void CLASS read_shorts (ushort *pixel, int count)
 {
-  if (fread (pixel, 2, count, ifp) < count) derror();
+  read_shorts (pixel, count, ifp);
+}
+
+/*RT*/ void CLASS read_shorts (ushort *pixel, int count, IMFILE *input)
+{
+  if (fread (pixel, 2, count, input) < count) derror();
   if ((order == 0x4949) == (ntohs(0x1234) == 0x1234))
 	  rtengine::swab ((char*)pixel, (char*)pixel, count*2);
 }
@@ -798,6 +803,13 @@ struct jhead {
 };
 
 int CLASS ljpeg_start (struct jhead *jh, int info_only)
+{
+  if (!ljpeg_start (jh, info_only, ifp)) return 0;
+  if (!info_only) zero_after_ff = 1;
+  return 1;
+}
+
+/*RT*/ int CLASS ljpeg_start (struct jhead *jh, int info_only, IMFILE *input)
 {
   ushort c, tag, len;
   uchar data[0x10000];
@@ -805,13 +817,13 @@ int CLASS ljpeg_start (struct jhead *jh, int info_only)
 
   memset (jh, 0, sizeof *jh);
   jh->restart = INT_MAX;
-  if ((fgetc(ifp),fgetc(ifp)) != 0xd8) return 0;
+  if ((fgetc(input),fgetc(input)) != 0xd8) return 0;
   do {
-    if (!fread (data, 2, 2, ifp)) return 0;
+    if (!fread (data, 2, 2, input)) return 0;
     tag =  data[0] << 8 | data[1];
     len = (data[2] << 8 | data[3]) - 2;
     if (tag <= 0xff00) return 0;
-    fread (data, 1, len, ifp);
+    fread (data, 1, len, input);
     switch (tag) {
       case 0xffc3:
 	jh->sraw = ((data[7] >> 4) * (data[7] & 15) - 1) & 3;
@@ -822,7 +834,7 @@ int CLASS ljpeg_start (struct jhead *jh, int info_only)
 	jh->high = data[1] << 8 | data[2];
 	jh->wide = data[3] << 8 | data[4];
 	jh->clrs = data[5] + jh->sraw;
-	if (len == 9 && !dng_version) getc(ifp);
+	if (len == 9 && !dng_version) getc(input);
 	break;
       case 0xffc4:
 	if (info_only) break;
@@ -851,7 +863,7 @@ int CLASS ljpeg_start (struct jhead *jh, int info_only)
   }
   jh->row = (ushort *) calloc (2 * jh->wide*jh->clrs, 4);
   merror (jh->row, "ljpeg_start()");
-  return zero_after_ff = 1;
+  return 1;
 }
 
 void CLASS ljpeg_end (struct jhead *jh)
@@ -861,20 +873,30 @@ void CLASS ljpeg_end (struct jhead *jh)
   free (jh->row);
 }
 
-inline int CLASS ljpeg_diff (ushort *huff)
+/*RT*/ inline int CLASS ljpeg_diff (ushort *huff, getbithuff_t &bithuff)
 {
   int len, diff;
 
-  len = gethuff(huff);
+  len = bithuff(*huff,huff+1);
   if (len == 16 && (!dng_version || dng_version >= 0x1010000))
     return -32768;
-  diff = getbits(len);
+  diff = bithuff(len,0);
   if ((diff & (1 << (len-1))) == 0)
     diff -= (1 << len) - 1;
   return diff;
 }
 
+inline int CLASS ljpeg_diff (ushort *huff)
+{
+  return ljpeg_diff (huff, getbithuff);
+}
+
 ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
+{
+  return ljpeg_row (jrow, jh, getbithuff, ifp);
+}
+
+/*RT*/ ushort * CLASS ljpeg_row (int jrow, struct jhead *jh, getbithuff_t &bithuff, IMFILE *input)
 {
   int col, c, diff, pred, spred=0;
   ushort mark=0, *row[3];
@@ -882,16 +904,16 @@ ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
   if (jrow * jh->wide % jh->restart == 0) {
     FORC(6) jh->vpred[c] = 1 << (jh->bits-1);
     if (jrow) {
-      fseek (ifp, -2, SEEK_CUR);
-      do mark = (mark << 8) + (c = fgetc(ifp));
+      fseek (input, -2, SEEK_CUR);
+      do mark = (mark << 8) + (c = fgetc(input));
       while (c != EOF && mark >> 4 != 0xffd);
     }
-    getbits(-1);
+    bithuff(-1,0);
   }
   FORC3 row[c] = (jh->row + ((jrow & 1) + 1) * (jh->wide*jh->clrs*((jrow+c) & 1)));
   for (col=0; col < jh->wide; col++)
     FORC(jh->clrs) {
-      diff = ljpeg_diff (jh->huff[c]);
+      diff = ljpeg_diff (jh->huff[c], bithuff);
       if (jh->sraw && c <= jh->sraw && (col | c))
 		    pred = spred;
       else if (col) pred = row[0][-jh->clrs];
@@ -912,6 +934,42 @@ ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
   return row[2];
 }
 
+/*RT*/
+/*
+   Find the start of every restart interval of the scan which follows ljpeg_start().
+   Returns false if the intervals can't be decoded independently of each other.
+ */
+bool CLASS ljpeg_restart_offsets (const struct jhead *jh, std::vector<int> &offsets)
+{
+  // intervals must start at row boundaries and rows must not be predicted from the row above
+  if (jh->restart == INT_MAX || jh->restart < jh->wide || jh->restart % jh->wide || jh->psv != 1 || jh->sraw)
+    return false;
+  const int interval_rows = jh->restart / jh->wide;
+  const int intervals = (jh->high + interval_rows - 1) / interval_rows;
+  if (intervals < 2)
+    return false;
+
+  offsets.clear();
+  offsets.reserve(intervals);
+  offsets.push_back(ftell(ifp));
+  const uchar *data = fdata(0, ifp);
+  for (int pos = ftell(ifp); (int)offsets.size() < intervals && pos < ifp->size - 1; pos++) {
+    if (data[pos] != 0xff)
+      continue;
+    const uchar next = data[pos+1];
+    if (next >= 0xd0 && next <= 0xd7) {
+      offsets.push_back(pos + 2);
+      pos++;
+    } else if (next == 0x00) {
+      pos++;
+    } else if (next != 0xff) {
+      // any other marker (e.g. EOI) before all intervals were found
+      return false;
+    }
+  }
+  return (int)offsets.size() == intervals;
+}
+
 void CLASS lossless_jpeg_load_raw()
 {
   struct jhead jh;
@@ -919,29 +977,13 @@ void CLASS lossless_jpeg_load_raw()
 
   if (!ljpeg_start (&jh, 0)) return;
   int jwide = jh.wide * jh.clrs;
-  ushort *rp[2];
-  rp[0] = ljpeg_row (0, &jh);
 
-  for (int jrow=0; jrow < jh.high; jrow++) {
-#ifdef _OPENMP
-#pragma omp parallel sections
-#endif
-{
-#ifdef _OPENMP
-    #pragma omp section
-#endif
-    {
-        if(jrow < jh.high - 1)
-            rp[(jrow + 1)&1] = ljpeg_row (jrow + 1, &jh);
-    }
-#ifdef _OPENMP
-     #pragma omp section
-#endif
-    {
+  const auto copy_row = [this, jwide](int jrow, ushort *rp, int &row, int &col)
+  {
     if (load_flags & 1)
       row = jrow & 1 ? height-1-jrow/2 : jrow/2;
     for (int jcol=0; jcol < jwide; jcol++) {
-      int val = curve[*rp[jrow&1]++];
+      int val = curve[*rp++];
       if (cr2_slice[0]) {
 	int jidx = jrow*jwide + jcol;
 	int i = jidx / (cr2_slice[1]*raw_height);
@@ -958,6 +1000,69 @@ void CLASS lossless_jpeg_load_raw()
       if (++col >= raw_width)
 	col = (row++,0);
     }
+  };
+
+#ifdef _OPENMP
+  std::vector<int> restarts;
+  // without slices, the raw_width == 3984 shift makes the position of a row depend on all rows before it
+  if ((cr2_slice[0] || raw_width != 3984) && ljpeg_restart_offsets (&jh, restarts)) {
+    // restart intervals are independent, decode them in parallel
+    const int interval_rows = jh.restart / jh.wide;
+    const int intervals = restarts.size();
+#pragma omp parallel
+{
+    IMFILE ifpthr = *ifp;
+    IMFILE *ifpthrptr = &ifpthr;
+    unsigned zero_after_ff_thr = 1;
+    getbithuff_t bithuff (this, ifpthrptr, zero_after_ff_thr);
+    struct jhead jhthr = jh;
+    jhthr.row = (ushort *) calloc (2 * jh.wide*jh.clrs, 4);
+    merror (jhthr.row, "lossless_jpeg_load_raw()");
+
+    // only master thread will update the progress bar
+    ifpthr.plistener = nullptr;
+    #pragma omp master
+    {
+    ifpthr.plistener = ifp->plistener;
+    }
+    #pragma omp for schedule(dynamic) nowait
+    for (int i = 0; i < intervals; i++) {
+      fseek (&ifpthr, restarts[i], SEEK_SET);
+      for (int jrow = i * interval_rows; jrow < std::min((i + 1) * interval_rows, jh.high); jrow++) {
+        // position of the first pixel of jrow as the sequential loop below would have it
+        INT64 jidx = (INT64) jrow * jwide;
+        int trow = jidx / raw_width;
+        int tcol = jidx % raw_width;
+        copy_row (jrow, ljpeg_row (jrow, &jhthr, bithuff, &ifpthr), trow, tcol);
+      }
+    }
+    free (jhthr.row);
+}
+    ljpeg_end (&jh);
+    return;
+  }
+#endif
+
+  ushort *rp[2];
+  rp[0] = ljpeg_row (0, &jh);
+
+  for (int jrow=0; jrow < jh.high; jrow++) {
+#ifdef _OPENMP
+#pragma omp parallel sections
+#endif
+{
+#ifdef _OPENMP
+    #pragma omp section
+#endif
+    {
+        if(jrow < jh.high - 1)
+            rp[(jrow + 1)&1] = ljpeg_row (jrow + 1, &jh);
+    }
+#ifdef _OPENMP
+     #pragma omp section
+#endif
+    {
+    copy_row (jrow, rp[jrow&1], row, col);
     }
 }
   }
@@ -1055,25 +1160,33 @@ void CLASS adobe_copy_pixel (unsigned row, unsigned col, ushort **rp)
 }
 
 void CLASS ljpeg_idct (struct jhead *jh)
+{
+  ljpeg_idct (jh, getbithuff);
+}
+
+/*RT*/ void CLASS ljpeg_idct (struct jhead *jh, getbithuff_t &bithuff)
 {
   int c, i, j, len, skip, coef;
   float work[3][8][8];
-  static float cs[106] = { 0 };
+  /*RT*/ // initialized once in a thread safe way, tiles may be decoded in parallel
+  static const struct idct_cos {
+    float v[106];
+    idct_cos() { for (int c=0; c < 106; c++) v[c] = cos((c & 31)*rtengine::RT_PI/16)/2; }
+  } cos_table;
+  const float *cs = cos_table.v;
   static const uchar zigzag[80] =
   {  0, 1, 8,16, 9, 2, 3,10,17,24,32,25,18,11, 4, 5,12,19,26,33,
     40,48,41,34,27,20,13, 6, 7,14,21,28,35,42,49,56,57,50,43,36,
     29,22,15,23,30,37,44,51,58,59,52,45,38,31,39,46,53,60,61,54,
     47,55,62,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63 };
 
-  if (!cs[0])
-    FORC(106) cs[c] = cos((c & 31)*rtengine::RT_PI/16)/2;
   memset (work, 0, sizeof work);
-  work[0][0][0] = jh->vpred[0] += ljpeg_diff (jh->huff[0]) * jh->quant[0];
+  work[0][0][0] = jh->vpred[0] += ljpeg_diff (jh->huff[0], bithuff) * jh->quant[0];
   for (i=1; i < 64; i++ ) {
-    len = gethuff (jh->huff[16]);
+    len = bithuff (*jh->huff[16], jh->huff[16]+1);
     i += skip = len >> 4;
     if (!(len &= 15) && skip < 15) break;
-    coef = getbits(len);
+    coef = bithuff(len,0);
     if ((coef & (1 << (len-1))) == 0)
       coef -= (1 << len) - 1;
     ((float *)work)[zigzag[i]] = coef * jh->quant[i];
@@ -1090,28 +1203,22 @@ void CLASS ljpeg_idct (struct jhead *jh)
   FORC(64) jh->idct[c] = CLIP(((float *)work[2])[c]+0.5);
 }
 
-void CLASS lossless_dng_load_raw()
+/*RT*/ void CLASS lossless_dng_decode_tile (struct jhead *jh, unsigned trow, unsigned tcol, getbithuff_t &bithuff, IMFILE *input)
 {
-  unsigned save, trow=0, tcol=0, jwide, jrow, jcol, row, col, i, j;
-  struct jhead jh;
+  unsigned jwide, jrow, jcol, row, col, i, j;
   ushort *rp;
 
-  while (trow < raw_height) {
-    save = ftell(ifp);
-    if (tile_length < INT_MAX)
-      fseek (ifp, get4(), SEEK_SET);
-    if (!ljpeg_start (&jh, 0)) break;
-    jwide = jh.wide;
-    if (filters) jwide *= jh.clrs;
-    jwide /= MIN (is_raw, tiff_samples);
-    switch (jh.algo) {
-      case 0xc1:
-	jh.vpred[0] = 16384;
-	getbits(-1);
-	for (jrow=0; jrow+7 < jh.high; jrow += 8) {
-	  for (jcol=0; jcol+7 < jh.wide; jcol += 8) {
-	    ljpeg_idct (&jh);
-	    rp = jh.idct;
+  jwide = jh->wide;
+  if (filters) jwide *= jh->clrs;
+  jwide /= MIN (is_raw, tiff_samples);
+  switch (jh->algo) {
+    case 0xc1:
+	jh->vpred[0] = 16384;
+	bithuff(-1,0);
+	for (jrow=0; jrow+7 < jh->high; jrow += 8) {
+	  for (jcol=0; jcol+7 < jh->wide; jcol += 8) {
+	    ljpeg_idct (jh, bithuff);
+	    rp = jh->idct;
 	    row = trow + jcol/tile_width + jrow*2;
 	    col = tcol + jcol%tile_width;
 	    for (i=0; i < 16; i+=2)
@@ -1120,15 +1227,79 @@ void CLASS lossless_dng_load_raw()
 	  }
 	}
 	break;
-      case 0xc3:
-	for (row=col=jrow=0; jrow < jh.high; jrow++) {
-	  rp = ljpeg_row (jrow, &jh);
+    case 0xc3:
+	for (row=col=jrow=0; jrow < jh->high; jrow++) {
+	  rp = ljpeg_row (jrow, jh, bithuff, input);
 	  for (jcol=0; jcol < jwide; jcol++) {
 	    adobe_copy_pixel (trow+row, tcol+col, &rp);
 	    if (++col >= tile_width || col >= raw_width)
 	      row += 1 + (col = 0);
 	  }
-	}    }
+	}
+  }
+}
+
+void CLASS lossless_dng_load_raw()
+{
+  unsigned save, trow=0, tcol=0;
+  struct jhead jh;
+
+#ifdef _OPENMP
+  if (tile_length < INT_MAX) {
+    // tiles are independent, read their offsets up front and decode them in parallel
+    struct dng_tile {
+      unsigned offset, row, col;
+    };
+    std::vector<dng_tile> tiles;
+    while (trow < raw_height) {
+      tiles.push_back ({get4(), trow, tcol});
+      if ((tcol += tile_width) >= raw_width)
+        trow += tile_length + (tcol = 0);
+    }
+    // the sequential decoding stops at the first tile without a valid header, check them before decoding any
+    for (size_t t = 0; t < tiles.size(); t++) {
+      fseek (ifp, tiles[t].offset, SEEK_SET);
+      const int valid = ljpeg_start (&jh, 0);
+      ljpeg_end (&jh);
+      if (!valid) {
+        tiles.resize (t);
+        break;
+      }
+    }
+    const int ntiles = tiles.size();
+#pragma omp parallel
+{
+    IMFILE ifpthr = *ifp;
+    IMFILE *ifpthrptr = &ifpthr;
+    unsigned zero_after_ff_thr = 1;
+    getbithuff_t bithuff (this, ifpthrptr, zero_after_ff_thr);
+    struct jhead jhthr;
+
+    // only master thread will update the progress bar
+    ifpthr.plistener = nullptr;
+    #pragma omp master
+    {
+    ifpthr.plistener = ifp->plistener;
+    }
+    #pragma omp for schedule(dynamic) nowait
+    for (int t = 0; t < ntiles; t++) {
+      fseek (&ifpthr, tiles[t].offset, SEEK_SET);
+      if (ljpeg_start (&jhthr, 0, &ifpthr)) {
+        lossless_dng_decode_tile (&jhthr, tiles[t].row, tiles[t].col, bithuff, &ifpthr);
+        ljpeg_end (&jhthr);
+      }
+    }
+}
+    return;
+  }
+#endif
+
+  while (trow < raw_height) {
+    save = ftell(ifp);
+    if (tile_length < INT_MAX)
+      fseek (ifp, get4(), SEEK_SET);
+    if (!ljpeg_start (&jh, 0)) break;
+    lossless_dng_decode_tile (&jh, trow, tcol, getbithuff, ifp);
     fseek (ifp, save+4, SEEK_SET);
     if ((tcol += tile_width) >= raw_width)
       trow += tile_length + (tcol = 0);
@@ -1141,6 +1312,47 @@ void CLASS packed_dng_load_raw()
   ushort *pixel, *rp;
   int row, col;
 
+#ifdef _OPENMP
+  /*RT*/ // every row starts at a known byte offset unless 0xff bytes are stuffed, decode the rows in parallel
+  if (tiff_bps == 16 || !zero_after_ff) {
+    const int start = ftell(ifp);
+    const INT64 rowbytes = tiff_bps == 16 ? (INT64) raw_width * tiff_samples * 2 : ((INT64) raw_width * tiff_samples * tiff_bps + 7) / 8;
+#pragma omp parallel
+{
+    IMFILE ifpthr = *ifp;
+    IMFILE *ifpthrptr = &ifpthr;
+    unsigned zero_after_ff_thr = 0;
+    getbithuff_t bithuff (this, ifpthrptr, zero_after_ff_thr);
+    ushort *pixelthr = (ushort *) calloc (raw_width, tiff_samples*sizeof *pixelthr);
+    merror (pixelthr, "packed_dng_load_raw()");
+
+    // only master thread will update the progress bar
+    ifpthr.plistener = nullptr;
+    #pragma omp master
+    {
+    ifpthr.plistener = ifp->plistener;
+    }
+    #pragma omp for schedule(dynamic,16) nowait
+    for (int row=0; row < raw_height; row++) {
+      fseek (&ifpthr, start + row * rowbytes, SEEK_SET);
+      if (tiff_bps == 16)
+        read_shorts (pixelthr, raw_width * tiff_samples, &ifpthr);
+      else {
+        bithuff(-1,0);
+        for (int col=0; col < raw_width * tiff_samples; col++)
+          pixelthr[col] = bithuff(tiff_bps,0);
+      }
+      ushort *rpthr = pixelthr;
+      for (int col=0; col < raw_width; col++)
+        adobe_copy_pixel (row, col, &rpthr);
+    }
+    free (pixelthr);
+}
+    fseek (ifp, start + raw_height * rowbytes, SEEK_SET);
+    return;
+  }
+#endif
+
   pixel = (ushort *) calloc (raw_width, tiff_samples*sizeof *pixel);
   merror (pixel, "packed_dng_load_raw()");
   for (row=0; row < raw_height; row++) {
@@ -21,7 +21,9 @@
 #define DCRAW_H
 
 #include "myfile.h"
+#include <atomic>
 #include <csetjmp>
+#include <vector>
 
 
 class DCraw
@@ -88,7 +90,8 @@ protected:
     unsigned thumb_misc, *oprof, fuji_layout, shot_select, multi_out;
     unsigned tiff_nifds, tiff_samples, tiff_bps, tiff_compress;
     unsigned black, cblack[4102], maximum, mix_green, raw_color, zero_is_bad;
-    unsigned zero_after_ff, is_raw, dng_version, is_foveon, data_error;
+    unsigned zero_after_ff, is_raw, dng_version, is_foveon;
+    std::atomic<unsigned> data_error; // counted by the parallel decoders too
     unsigned tile_width, tile_length, gpsdata[32], load_flags;
     bool xtransCompressed = false;
     struct fuji_compressed_params
@@ -122,8 +125,7 @@ protected:
         INT64       cur_buf_offset;  // offset of this buffer in a file
         unsigned	max_read_size;	 // Amount of data to be read
         int         cur_buf_size;    // buffer size
-        uchar       *cur_buf;        // currently read block
-        int         fillbytes;          // Counter to add extra byte for block size N*16
+        const uchar *cur_buf;        // currently read block
         IMFILE      *input;
         struct int_pair grad_even[3][41];    // tables of gradients
         struct int_pair grad_odd[3][41];
@@ -223,6 +225,7 @@ unsigned getint (int type);
 float int_to_float (int i);
 double getreal (int type);
 void read_shorts (ushort *pixel, int count);
+void read_shorts (ushort *pixel, int count, IMFILE *input);
 void cubic_spline(const int *x_, const int *y_, const int len);
 void canon_600_fixed_wb (int temp);
 int canon_600_color (int ratio[2], int mar);
@@ -259,15 +262,21 @@ void crw_init_tables (unsigned table, ushort *huff[2]);
 int canon_has_lowbits();
 void canon_load_raw();
 int ljpeg_start (struct jhead *jh, int info_only);
+int ljpeg_start (struct jhead *jh, int info_only, IMFILE *input);
 void ljpeg_end (struct jhead *jh);
 int ljpeg_diff (ushort *huff);
+int ljpeg_diff (ushort *huff, getbithuff_t &bithuff);
 ushort * ljpeg_row (int jrow, struct jhead *jh);
+ushort * ljpeg_row (int jrow, struct jhead *jh, getbithuff_t &bithuff, IMFILE *input);
+bool ljpeg_restart_offsets (const struct jhead *jh, std::vector<int> &offsets);
 void lossless_jpeg_load_raw();
 void ljpeg_idct (struct jhead *jh);
+void ljpeg_idct (struct jhead *jh, getbithuff_t &bithuff);
 
 
 void canon_sraw_load_raw();
 void adobe_copy_pixel (unsigned row, unsigned col, ushort **rp);
+void lossless_dng_decode_tile (struct jhead *jh, unsigned trow, unsigned tcol, getbithuff_t &bithuff, IMFILE *input);
 void lossless_dng_load_raw();
 void packed_dng_load_raw();
 void deflate_dng_load_raw();
@@ -48,7 +48,7 @@ Crop::Crop (ImProcCoordinator* parent, EditDataProvider *editDataProvider, bool
       trafx (0), trafy (0), trafw (-1), trafh (-1),
       rqcropx (0), rqcropy (0), rqcropw (-1), rqcroph (-1),
       borderRequested (32), upperBorder (0), leftBorder (0),
-      cropAllocated (false),
+      cropAllocated (false), staleBuffers (false),
       cropImageListener (nullptr), parent (parent), isDetailWindow (isDetailWindow)
 {
     parent->crops.push_back (this);
@@ -82,6 +82,7 @@ void Crop::setListener (DetailedCropListener* il)
     if (cropImageListener != il) {
         MyMutex::MyLock lock (cropMutex);
         cropImageListener = il;
+        tileCache.clear ();
     }
 }
 
@@ -131,6 +132,18 @@ void Crop::update (int todo)
 {
     MyMutex::MyLock cropLock (cropMutex);
 
+    // the processing parameters changed, the cached tiles are obsolete
+    tileCache.clear ();
+    process (todo, false);
+}
+
+/* @brief Processes the crop
+ *
+ * If tilePass is true, the rqcropx/y/w/h area is processed to fill the tile cache and nothing is sent to the listener,
+ * otherwise the window of the listener is processed. cropMutex has to be locked by the caller.
+ */
+void Crop::process (int todo, bool tilePass)
+{
     ProcParams& params = parent->params;
 //       CropGUIListener* cropgl;
 
@@ -141,7 +154,7 @@ void Crop::update (int todo)
     int wx, wy, ww, wh, ws;
     bool overrideWindow = false;
 
-    if (cropImageListener) {
+    if (cropImageListener && !tilePass) {
         overrideWindow = cropImageListener->getWindow (wx, wy, ww, wh, ws);
     }
 
@@ -155,10 +168,13 @@ void Crop::update (int todo)
     }
 
     // it something has been reallocated, all processing steps have to be performed
-    if (needsinitupdate || (todo & M_HIGHQUAL)) {
+    // (the buffers don't match the window either when it has been displayed from the tile cache or the last processing was cancelled)
+    if (needsinitupdate || staleBuffers || (todo & M_HIGHQUAL)) {
         todo = ALL;
     }
 
+    staleBuffers = false;
+
     // Tells to the ImProcFunctions' tool what is the preview scale, which may lead to some simplifications
     parent->ipf.setScale (skip);
 
@@ -177,6 +193,11 @@ void Crop::update (int todo)
             setCropSizes (rqcropx, rqcropy, rqcropw, rqcroph, skip, true);
         }
 
+        if (skip == 1 && parent->regionDemosaic) {
+            // the full frame has been demosaiced with the fast method, bring our part of it to the requested one
+            parent->imgsrc->demosaicRegion (params.raw, tr, PreviewProps (trafx, trafy, trafw, trafh, 1));
+        }
+
         //  printf("x=%d y=%d crow=%d croh=%d skip=%d\n",rqcropx, rqcropy, rqcropw, rqcroph, skip);
         //  printf("trafx=%d trafyy=%d trafwsk=%d trafHs=%d \n",trafx, trafy, trafw*skip, trafh*skip);
 
@@ -427,6 +448,18 @@ void Crop::update (int todo)
             float gam, gamthresh, gamslope;
             parent->ipf.RGB_denoise_infoGamCurve (params.dirpyrDenoise, parent->imgsrc->isRAW(), gamcurve, gam, gamthresh, gamslope);
             int Nb[9];
+
+            if (parent->regionDemosaic) {
+                // the noise is measured on the same parts of the image as below
+                for (int wcr = 0; wcr <= 2; wcr++) {
+                    for (int hcr = 0; hcr <= 2; hcr++) {
+                        const int cx = wcr == 0 ? 50 : wcr == 1 ? widIm / 2 - crW / 2 : widIm - crW - 50;
+                        const int cy = hcr == 0 ? 50 : hcr == 1 ? heiIm / 2 - crH / 2 : heiIm - crH - 50;
+                        parent->imgsrc->demosaicRegion (params.raw, tr, PreviewProps (cx, cy, crW, crH, 1));
+                    }
+                }
+            }
+
 #ifdef _OPENMP
             #pragma omp parallel
 #endif
@@ -687,6 +720,10 @@ void Crop::update (int todo)
 
     }
 
+    if (cancelled ()) {
+        return;
+    }
+
     // has to be called after setCropSizes! Tools prior to this point can't handle the Edit mechanism, but that shouldn't be a problem.
     createBuffer (cropw, croph);
 
@@ -789,10 +826,15 @@ void Crop::update (int todo)
     }*/
 
     // apply luminance operations
-    if (todo & (M_LUMINANCE + M_COLOR)) {
+    if (todo & M_LABSTAGES) {
         //I made a little change here. Rather than have luminanceCurve (and others) use in/out lab images, we can do more if we copy right here.
-        labnCrop->CopyFrom (laboCrop);
+        // The stages whose parameters didn't change start from the cached output of the previous stage
+        const LabStageCache::Stage firstStage = labStages.begin (todo, laboCrop, labnCrop);
 
+        // The output of a stage is only cached if one of the following stages has something to do
+        const bool camDetail = !(params.colorappearance.enabled && settings->autocielab);
+        const bool detailEnabled = skip == 1 && (params.sharpenEdge.enabled || (camDetail && (params.impulseDenoise.enabled || params.defringe.enabled || params.sharpenMicro.enabled || params.sharpening.enabled)));
+        const bool cbdlEnabled = camDetail && params.dirpyrequalizer.enabled && params.dirpyrequalizer.cbdlMethod == "aft";
 
         //parent->ipf.luminanceCurve (labnCrop, labnCrop, parent->lumacurve);
         bool utili = parent->utili;
@@ -804,17 +846,26 @@ void Crop::update (int todo)
         bool wavcontlutili = parent->wavcontlutili;
 
         LUTu dummy;
-        //    parent->ipf.MSR(labnCrop, labnCrop->W, labnCrop->H, 1);
-        parent->ipf.chromiLuminanceCurve (this, 1, labnCrop, labnCrop, parent->chroma_acurve, parent->chroma_bcurve, parent->satcurve, parent->lhskcurve,  parent->clcurve, parent->lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, dummy, dummy);
-        parent->ipf.vibrance (labnCrop);
 
-        if ((params.colorappearance.enabled && !params.colorappearance.tonecie) ||  (!params.colorappearance.enabled)) {
-            parent->ipf.EPDToneMap (labnCrop, 5, skip);
+        if (firstStage <= LabStageCache::COLOR) {
+            //    parent->ipf.MSR(labnCrop, labnCrop->W, labnCrop->H, 1);
+            parent->ipf.chromiLuminanceCurve (this, 1, labnCrop, labnCrop, parent->chroma_acurve, parent->chroma_bcurve, parent->satcurve, parent->lhskcurve,  parent->clcurve, parent->lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, dummy, dummy);
+            parent->ipf.vibrance (labnCrop);
+
+            if ((params.colorappearance.enabled && !params.colorappearance.tonecie) ||  (!params.colorappearance.enabled)) {
+                parent->ipf.EPDToneMap (labnCrop, 5, skip);
+            }
+
+            if (cancelled ()) {
+                return;
+            }
+
+            labStages.store (LabStageCache::COLOR, labnCrop, detailEnabled || cbdlEnabled || params.wavelet.enabled || params.colorappearance.enabled);
         }
 
         //parent->ipf.EPDToneMap(labnCrop, 5, 1);    //Go with much fewer than normal iterates for fast redisplay.
         // for all treatments Defringe, Sharpening, Contrast detail , Microcontrast they are activated if "CIECAM" function are disabled
-        if (skip == 1) {
+        if (firstStage <= LabStageCache::DETAIL && skip == 1) {
             if ((params.colorappearance.enabled && !settings->autocielab)  || (!params.colorappearance.enabled)) {
                 parent->ipf.impulsedenoise (labnCrop);
             }
@@ -829,16 +880,20 @@ void Crop::update (int todo)
                 parent->ipf.MLmicrocontrast (labnCrop);
                 parent->ipf.sharpening (labnCrop, (float**)cbuffer, params.sharpening);
             }
+
+            labStages.store (LabStageCache::DETAIL, labnCrop, detailEnabled && (cbdlEnabled || params.wavelet.enabled || params.colorappearance.enabled));
         }
 
         //   if (skip==1) {
         WaveletParams WaveParams = params.wavelet;
 
-        if (params.dirpyrequalizer.cbdlMethod == "aft") {
+        if (firstStage <= LabStageCache::CBDL && params.dirpyrequalizer.cbdlMethod == "aft") {
             if (((params.colorappearance.enabled && !settings->autocielab)  || (!params.colorappearance.enabled))) {
                 parent->ipf.dirpyrequalizer (labnCrop, skip);
                 //  parent->ipf.Lanczoslab (labnCrop,labnCrop , 1.f/skip);
             }
+
+            labStages.store (LabStageCache::CBDL, labnCrop, cbdlEnabled && (params.wavelet.enabled || params.colorappearance.enabled));
         }
 
         int kall = 0;
@@ -910,7 +965,7 @@ void Crop::update (int todo)
             parent->awavListener->wavChanged (float (maxL));
         }
 
-        if ((params.wavelet.enabled)) {
+        if (firstStage <= LabStageCache::WAVELET && params.wavelet.enabled) {
             WavCurve wavCLVCurve;
             WavOpacityCurveRG waOpacityCurveRG;
             WavOpacityCurveBY waOpacityCurveBY;
@@ -922,6 +977,12 @@ void Crop::update (int todo)
             params.wavelet.getCurves (wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL);
 
             parent->ipf.ip_wavelet (labnCrop, labnCrop, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL, parent->wavclCurve, wavcontlutili, skip);
+
+            if (cancelled ()) {
+                return;
+            }
+
+            labStages.store (LabStageCache::WAVELET, labnCrop, params.colorappearance.enabled);
         }
 
         //     }
@@ -987,6 +1048,21 @@ void Crop::update (int todo)
         // internal image in output color space for analysis
         Image8 *cropImgtrue = parent->ipf.lab2rgb (labnCrop, 0, 0, cropw, croph, params.icm);
 
+        if (useTiles (skip)) {
+            // only the tiles far enough from the borders of the processed area are identical to the whole image processing
+            const int margin = getTileMargin ();
+            tileCache.put (cropImg, cropImgtrue, cropx, cropy,
+                           cropx > 0 ? cropx + margin : 0, cropy > 0 ? cropy + margin : 0,
+                           cropx + cropw < parent->fullw ? cropx + cropw - margin : parent->fullw,
+                           cropy + croph < parent->fullh ? cropy + croph - margin : parent->fullh,
+                           parent->fullw, parent->fullh);
+        }
+
+        if (tilePass) {
+            delete cropImgtrue;
+            return;
+        }
+
         int finalW = rqcropw;
 
         if (cropImg->getWidth() - leftBorder < finalW) {
@@ -1014,6 +1090,115 @@ void Crop::update (int todo)
     }
 }
 
+/* @brief Updates the crop after a change of its window, the processing parameters being the same
+ *
+ * At 100%, the processed image is kept in a tile cache, so only the tiles which haven't been displayed yet are
+ * processed, with a border large enough for the enabled tools. cropMutex has to be unlocked.
+ */
+void Crop::updateWindow ()
+{
+    MyMutex::MyLock cropLock (cropMutex);
+
+    int wx, wy, ww, wh, ws;
+
+    if (!cropImageListener || !cropImageListener->getWindow (wx, wy, ww, wh, ws)) {
+        wx = rqcropx;
+        wy = rqcropy;
+        ww = rqcropw;
+        wh = rqcroph;
+        ws = skip;
+    }
+
+    if (!useTiles (ws) || ww <= 0 || wh <= 0) {
+        process (ALL, false);
+        return;
+    }
+
+    const int x1 = LIM (wx, 0, parent->fullw - 1);
+    const int y1 = LIM (wy, 0, parent->fullh - 1);
+    const int x2 = LIM (x1 + ww, 1, parent->fullw);
+    const int y2 = LIM (y1 + wh, 1, parent->fullh);
+
+    int total, mx1, my1, mx2, my2;
+    const int missing = tileCache.getMissing (x1, y1, x2, y2, parent->fullw, parent->fullh, total, mx1, my1, mx2, my2);
+
+    if (2 * missing > total) {
+        // most of the window is new, processing it as a whole is cheaper
+        process (ALL, false);
+        return;
+    }
+
+    if (missing) {
+        // setCropSizes adds borderRequested around the requested area
+        const int extra = getTileMargin () - borderRequested;
+        const int rx1 = std::max (mx1 - extra, 0);
+        const int ry1 = std::max (my1 - extra, 0);
+        rqcropx = rx1;
+        rqcropy = ry1;
+        rqcropw = std::min (mx2 + extra, parent->fullw) - rx1;
+        rqcroph = std::min (my2 + extra, parent->fullh) - ry1;
+        skip = ws;
+        process (ALL, true);
+    }
+
+    // the buffers are left as is until the next processing, which will be a full one
+    rqcropx = wx;
+    rqcropy = wy;
+    rqcropw = ww;
+    rqcroph = wh;
+    skip = ws;
+    staleBuffers = true;
+
+    Image8* final = new Image8 (x2 - x1, y2 - y1);
+    Image8* finaltrue = new Image8 (x2 - x1, y2 - y1);
+
+    if (tileCache.get (x1, y1, final, finaltrue)) {
+        cropImageListener->setDetailedCrop (final, finaltrue, parent->params.icm, parent->params.crop, rqcropx, rqcropy, rqcropw, rqcroph, skip);
+    } else {
+        // some tiles have been evicted, or couldn't be processed
+        process (ALL, false);
+    }
+
+    delete final;
+    delete finaltrue;
+}
+
+bool Crop::useTiles (int skip)
+{
+    // the edit tools need the buffers of the whole window
+    return skip == 1 && cropImageListener && getCurrEditID() == EUID_None;
+}
+
+/* @brief Tells if the processing has been superseded by new parameters
+ *
+ * The buffers are then flagged as stale, so that the next processing starts from scratch.
+ */
+bool Crop::cancelled ()
+{
+    if (parent->ipf.isCancelled ()) {
+        staleBuffers = true;
+        return true;
+    }
+
+    return false;
+}
+
+int Crop::getTileMargin ()
+{
+    const ProcParams& params = parent->params;
+
+    // the tools working on large neighbourhoods need a larger border for the tiles to match the processing of the whole image
+    if (params.wavelet.enabled || params.epd.enabled || params.retinex.enabled || params.colorappearance.enabled) {
+        return 256;
+    }
+
+    if (params.dirpyrDenoise.enabled || params.sh.enabled || params.dirpyrequalizer.enabled) {
+        return 128;
+    }
+
+    return borderRequested;
+}
+
 void Crop::freeAll ()
 {
 
@@ -1042,6 +1227,9 @@ void Crop::freeAll ()
             labnCrop = nullptr;
         }
 
+        labStages.clear ();
+        tileCache.clear ();
+
         if (cropImg  ) {
             delete    cropImg;
             cropImg = nullptr;
@@ -1233,6 +1421,7 @@ bool Crop::setCropSizes (int rcx, int rcy, int rcw, int rch, int skip, bool inte
         }
 
         labnCrop = new LabImage (cropw, croph);
+        labStages.clear ();
 
         if (!cropImg) {
             cropImg = new Image8;
@@ -1345,7 +1534,7 @@ void Crop::fullUpdate ()
 
     while (newUpdatePending) {
         newUpdatePending = false;
-        update (ALL);
+        updateWindow ();
     }
 
     updating = false;  // end of crop update
@@ -26,6 +26,8 @@
 #include "imagesource.h"
 #include "procevents.h"
 #include "pipettebuffer.h"
+#include "labstagecache.h"
+#include "croptilecache.h"
 #include "../rtgui/threadutils.h"
 
 namespace rtengine
@@ -43,6 +45,7 @@ protected:
     Imagefloat*  origCrop;   // "one chunk" allocation
     LabImage*    laboCrop;   // "one chunk" allocation
     LabImage*    labnCrop;   // "one chunk" allocation
+    LabStageCache labStages; // cached outputs of the stages applied to labnCrop
     Image8*      cropImg;    // "one chunk" allocation ; displayed image in monitor color space, showing the output profile as well (soft-proofing enabled, which then correspond to workimg) or not
     float *      cbuf_real;  // "one chunk" allocation
     SHMap*       cshmap;     // per line allocation
@@ -63,6 +66,8 @@ protected:
     int upperBorder, leftBorder;            /// extra border size really allocated for image processing
 
     bool cropAllocated;
+    CropTileCache tileCache;                /// processed tiles of the image at 100%, for the current processing parameters
+    bool staleBuffers;                      /// the buffers don't match the window (displayed from the tile cache, or cancelled processing)
     DetailedCropListener* cropImageListener;
 
     MyMutex cropMutex;
@@ -71,6 +76,11 @@ protected:
     EditUniqueID getCurrEditID();
     bool setCropSizes (int cropX, int cropY, int cropW, int cropH, int skip, bool internal);
     void freeAll ();
+    void process (int todo, bool tilePass);
+    void updateWindow ();
+    bool useTiles (int skip);
+    int getTileMargin ();
+    bool cancelled ();
 
 public:
     Crop             (ImProcCoordinator* parent, EditDataProvider *editDataProvider, bool isDetailWindow);
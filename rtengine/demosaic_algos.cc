@@ -1315,7 +1315,7 @@ void RawImageSource::jdl_interpolate_omp()  // from "Lassus"
 // Adapted to RawTherapee by Jacques Desmis 3/2013
 // Improved speed and reduced memory consumption by Ingo Weyrich 2/2015
 //TODO Tiles to reduce memory consumption
-SSEFUNCTION void RawImageSource::lmmse_interpolate_omp(int winw, int winh, array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue, int iterations)
+SSEFUNCTION MULTIVERSION void RawImageSource::lmmse_interpolate_omp(int winw, int winh, array2D<float> &rawData, array2D<float> &red, array2D<float> &green, array2D<float> &blue, int iterations)
 {
     const int width = winw, height = winh;
     const int ba = 10;
@@ -1947,7 +1947,7 @@ SSEFUNCTION void RawImageSource::lmmse_interpolate_omp(int winw, int winh, array
 // SSE version by Ingo Weyrich 5/2013
 #ifdef __SSE2__
 #define CLIPV(a) LIMV(a,zerov,c65535v)
-SSEFUNCTION void RawImageSource::igv_interpolate(int winw, int winh)
+SSEFUNCTION MULTIVERSION void RawImageSource::igv_interpolate(int winw, int winh)
 {
     static const float eps = 1e-5f, epssq = 1e-5f; //mod epssq -10f =>-5f Jacques 3/2013 to prevent artifact (divide by zero)
 
@@ -2339,7 +2339,7 @@ SSEFUNCTION void RawImageSource::igv_interpolate(int winw, int winh)
 }
 #undef CLIPV
 #else
-void RawImageSource::igv_interpolate(int winw, int winh)
+MULTIVERSION void RawImageSource::igv_interpolate(int winw, int winh)
 {
     static const float eps = 1e-5f, epssq = 1e-5f; //mod epssq -10f =>-5f Jacques 3/2013 to prevent artifact (divide by zero)
     static const int h1 = 1, h2 = 2, h3 = 3, h4 = 4, h5 = 5, h6 = 6;
@@ -2864,6 +2864,86 @@ void RawImageSource::nodemosaic(bool bw)
     }
 }
 
+bool RawImageSource::demosaicBinned(const RAWParams &raw, int tran, const PreviewProps &pp)
+{
+    const int skip = pp.getSkip();
+    const bool bayer = ri->getSensorType() == ST_BAYER
+                       && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::mono]
+                       && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::none];
+    // every 3x3 block of the X-Trans pattern holds the 3 colors
+    const bool xtrans = ri->getSensorType() == ST_FUJI_XTRANS && skip >= 3
+                        && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::mono]
+                        && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::none];
+
+    if (skip < 2 || fuji || d1x || !(bayer || xtrans)) {
+        return false;
+    }
+
+    MyTime t1, t2;
+    t1.set();
+
+    // align the blocks on the ones getImage averages for pp
+    int sx1, sy1, width, height, fw;
+    transformRect(pp, defTransform(tran), sx1, sy1, width, height, fw);
+    const int ox = sx1 % skip;
+    const int oy = sy1 % skip;
+    // the first row and column of blocks may be partial
+    const int blocksW = (W - ox + skip - 1) / skip + 1;
+    const int blocksH = (H - oy + skip - 1) / skip + 1;
+
+    red(W, H);
+    green(W, H);
+    blue(W, H);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 4)
+#endif
+
+    for (int by = 0; by < blocksH; by++) {
+        const int y0 = std::max(oy + (by - 1) * skip, 0);
+        const int y1 = std::min(oy + by * skip, H);
+
+        for (int bx = 0; bx < blocksW; bx++) {
+            const int x0 = std::max(ox + (bx - 1) * skip, 0);
+            const int x1 = std::min(ox + bx * skip, W);
+
+            // superpixel: mean of the sites of each color in the block
+            float sum[3] = {0.f, 0.f, 0.f};
+            int count[3] = {0, 0, 0};
+
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    const int c = xtrans ? ri->XTRANSFC(y, x) : FC(y, x);
+                    sum[c] += rawData[y][x];
+                    count[c]++;
+                }
+            }
+
+            const float r = count[0] ? sum[0] / count[0] : 0.f;
+            const float g = count[1] ? sum[1] / count[1] : 0.f;
+            const float b = count[2] ? sum[2] / count[2] : 0.f;
+
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    red[y][x] = r;
+                    green[y][x] = g;
+                    blue[y][x] = b;
+                }
+            }
+        }
+    }
+
+    rgbSourceModified = false;
+    setRegionState(std::string()); // no demosaic method to refine from
+
+    if (settings->verbose) {
+        t2.set();
+        printf("Binning raw data %dx%d - %d usec\n", skip, skip, t2.etime(t1));
+    }
+
+    return true;
+}
+
 /*
    Refinement based on EECI demosaicing algorithm by L. Chang and Y.P. Tan
    Paul Lee
@@ -3984,7 +4064,7 @@ void RawImageSource::xtransborder_interpolate (int border)
 */
 // override CLIP function to test unclipped output
 #define CLIP(x) (x)
-void RawImageSource::xtrans_interpolate (const int passes, const bool useCieLab)
+MULTIVERSION void RawImageSource::xtrans_interpolate (const int passes, const bool useCieLab)
 {
     BENCHFUN
     constexpr int ts = 114;      /* Tile Size */
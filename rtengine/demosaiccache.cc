@@ -0,0 +1,304 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include <glib/gstdio.h>
+
+#include "demosaiccache.h"
+
+#include "halffloat.h"
+#include "settings.h"
+
+namespace rtengine
+{
+
+extern const Settings* settings;
+
+}
+
+namespace
+{
+
+constexpr char cacheMagic[4] = {'R', 'T', 'D', 'C'};
+constexpr std::uint32_t cacheVersion = 1;
+const Glib::ustring cacheExtension = ".rtdc";
+
+// planes are in [0;65535] (and above for highlights), scale them into the range of half floats
+constexpr float storeScale = 1.f / 65536.f;
+constexpr float loadScale = 65536.f;
+
+struct CacheHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::int32_t width;
+    std::int32_t height;
+};
+
+bool readPlane(FILE* f, int width, int height, std::vector<std::uint16_t>& buffer, array2D<float>& plane)
+{
+    if (fread(buffer.data(), sizeof(std::uint16_t), buffer.size(), f) != buffer.size()) {
+        return false;
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,16)
+#endif
+
+    for (int i = 0; i < height; ++i) {
+        const std::uint16_t* src = buffer.data() + static_cast<std::size_t>(i) * width;
+
+        for (int j = 0; j < width; ++j) {
+            plane[i][j] = rtengine::halfToFloat(src[j]) * loadScale;
+        }
+    }
+
+    return true;
+}
+
+bool writePlane(FILE* f, int width, int height, std::vector<std::uint16_t>& buffer, const array2D<float>& plane)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,16)
+#endif
+
+    for (int i = 0; i < height; ++i) {
+        std::uint16_t* dst = buffer.data() + static_cast<std::size_t>(i) * width;
+
+        for (int j = 0; j < width; ++j) {
+            dst[j] = rtengine::floatToHalf(plane[i][j] * storeScale);
+        }
+    }
+
+    return fwrite(buffer.data(), sizeof(std::uint16_t), buffer.size(), f) == buffer.size();
+}
+
+}
+
+rtengine::DemosaicCache& rtengine::DemosaicCache::getInstance()
+{
+    static DemosaicCache instance;
+    return instance;
+}
+
+bool rtengine::DemosaicCache::isEnabled() const
+{
+    return settings && settings->demosaicCacheSize > 0 && !settings->demosaicCacheDir.empty();
+}
+
+std::string rtengine::DemosaicCache::getPreprocessKey(const procparams::RAWParams& raw, const procparams::LensProfParams& lensProf, const procparams::CoarseTransformParams& coarse)
+{
+    std::ostringstream key;
+
+    key << raw.dark_frame << ';' << raw.df_autoselect << ';'
+        << raw.ff_file << ';' << raw.ff_AutoSelect << ';' << raw.ff_BlurRadius << ';' << raw.ff_BlurType << ';'
+        << raw.ff_AutoClipControl << ';' << raw.ff_clipControl << ';'
+        << raw.ca_autocorrect << ';' << raw.cared << ';' << raw.cablue << ';'
+        << raw.expos << ';' << raw.preser << ';'
+        << raw.hotPixelFilter << ';' << raw.deadPixelFilter << ';' << raw.hotdeadpix_thresh << ';'
+        << raw.bayersensor.black0 << ';' << raw.bayersensor.black1 << ';' << raw.bayersensor.black2 << ';' << raw.bayersensor.black3 << ';'
+        << raw.bayersensor.twogreen << ';' << raw.bayersensor.linenoise << ';' << raw.bayersensor.greenthresh << ';'
+        << raw.xtranssensor.blackred << ';' << raw.xtranssensor.blackgreen << ';' << raw.xtranssensor.blackblue << ';'
+        << static_cast<int>(lensProf.lcMode) << ';' << lensProf.lcpFile << ';' << lensProf.useVign << ';'
+        << lensProf.lfCameraMake << ';' << lensProf.lfCameraModel << ';' << lensProf.lfLens << ';'
+        << coarse.rotate << ';' << coarse.hflip << ';' << coarse.vflip;
+
+    return key.str();
+}
+
+std::string rtengine::DemosaicCache::getKey(const Glib::ustring& fname, unsigned int frame, const std::string& preprocessKey, const procparams::RAWParams& raw)
+{
+    GStatBuf st;
+
+    if (fname.empty() || g_stat(fname.c_str(), &st) != 0) {
+        return {};
+    }
+
+    const procparams::RAWParams::BayerSensor& bayer = raw.bayersensor;
+    std::ostringstream key;
+
+    key << fname << ';' << st.st_size << ';' << st.st_mtime << ';' << frame << ';' << preprocessKey << ';'
+        << bayer.method << ';' << bayer.imageNum << ';' << bayer.ccSteps << ';'
+        << bayer.dcb_iterations << ';' << bayer.dcb_enhance << ';' << bayer.lmmse_iterations << ';'
+        << bayer.pixelShiftMotion << ';' << bayer.pixelShiftMotionCorrection << ';' << bayer.pixelShiftMotionCorrectionMethod << ';'
+        << bayer.pixelShiftStddevFactorGreen << ';' << bayer.pixelShiftStddevFactorRed << ';' << bayer.pixelShiftStddevFactorBlue << ';'
+        << bayer.pixelShiftEperIso << ';' << bayer.pixelShiftNreadIso << ';' << bayer.pixelShiftPrnu << ';'
+        << bayer.pixelShiftSigma << ';' << bayer.pixelShiftSum << ';' << bayer.pixelShiftRedBlueWeight << ';'
+        << bayer.pixelShiftShowMotion << ';' << bayer.pixelShiftShowMotionMaskOnly << ';' << bayer.pixelShiftAutomatic << ';'
+        << bayer.pixelShiftNonGreenHorizontal << ';' << bayer.pixelShiftNonGreenVertical << ';' << bayer.pixelShiftHoleFill << ';'
+        << bayer.pixelShiftMedian << ';' << bayer.pixelShiftMedian3 << ';' << bayer.pixelShiftGreen << ';' << bayer.pixelShiftBlur << ';'
+        << bayer.pixelShiftSmoothFactor << ';' << bayer.pixelShiftExp0 << ';' << bayer.pixelShiftLmmse << ';'
+        << bayer.pixelShiftEqualBright << ';' << bayer.pixelShiftEqualBrightChannel << ';'
+        << bayer.pixelShiftNonGreenCross << ';' << bayer.pixelShiftNonGreenCross2 << ';' << bayer.pixelShiftNonGreenAmaze << ';'
+        << raw.xtranssensor.method << ';' << raw.xtranssensor.ccSteps;
+
+    return Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_MD5, key.str());
+}
+
+Glib::ustring rtengine::DemosaicCache::getFileName(const std::string& key) const
+{
+    return Glib::build_filename(settings->demosaicCacheDir, key + cacheExtension);
+}
+
+bool rtengine::DemosaicCache::load(const std::string& key, int width, int height, array2D<float>& red, array2D<float>& green, array2D<float>& blue)
+{
+    if (!isEnabled() || key.empty()) {
+        return false;
+    }
+
+    MyMutex::MyLock lock(mutex);
+
+    const Glib::ustring fname = getFileName(key);
+    FILE* const f = g_fopen(fname.c_str(), "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    CacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1
+              && !memcmp(header.magic, cacheMagic, sizeof(cacheMagic))
+              && header.version == cacheVersion
+              && header.width == width
+              && header.height == height;
+
+    if (ok) {
+        red(width, height);
+        green(width, height);
+        blue(width, height);
+
+        std::vector<std::uint16_t> buffer(static_cast<std::size_t>(width) * height);
+        ok = readPlane(f, width, height, buffer, red)
+             && readPlane(f, width, height, buffer, green)
+             && readPlane(f, width, height, buffer, blue);
+    }
+
+    fclose(f);
+
+    if (ok) {
+        // mark as recently used
+        g_utime(fname.c_str(), nullptr);
+    } else {
+        g_remove(fname.c_str());
+    }
+
+    if (settings->verbose) {
+        printf("Demosaic cache %s: %s\n", ok ? "hit" : "invalid entry", fname.c_str());
+    }
+
+    return ok;
+}
+
+void rtengine::DemosaicCache::store(const std::string& key, int width, int height, const array2D<float>& red, const array2D<float>& green, const array2D<float>& blue)
+{
+    if (!isEnabled() || key.empty()) {
+        return;
+    }
+
+    MyMutex::MyLock lock(mutex);
+
+    const Glib::ustring dir = settings->demosaicCacheDir;
+    const unsigned long long maxBytes = static_cast<unsigned long long>(settings->demosaicCacheSize) * 1024 * 1024;
+    const unsigned long long entryBytes = sizeof(CacheHeader) + 3ull * width * height * sizeof(std::uint16_t);
+
+    if (entryBytes > maxBytes || g_mkdir_with_parents(dir.c_str(), 0755) != 0) {
+        return;
+    }
+
+    const Glib::ustring fname = getFileName(key);
+    const Glib::ustring tmpName = fname + ".tmp";
+    FILE* const f = g_fopen(tmpName.c_str(), "wb");
+
+    if (!f) {
+        return;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.width = width;
+    header.height = height;
+
+    std::vector<std::uint16_t> buffer(static_cast<std::size_t>(width) * height);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+              && writePlane(f, width, height, buffer, red)
+              && writePlane(f, width, height, buffer, green)
+              && writePlane(f, width, height, buffer, blue);
+
+    ok = fclose(f) == 0 && ok;
+
+    // rename at the end so that other instances never see half written entries
+    if (!ok || g_rename(tmpName.c_str(), fname.c_str()) != 0) {
+        g_remove(tmpName.c_str());
+        return;
+    }
+
+    if (settings->verbose) {
+        printf("Demosaic cache: stored %s\n", fname.c_str());
+    }
+
+    trim(dir, maxBytes);
+}
+
+void rtengine::DemosaicCache::trim(const Glib::ustring& dir, unsigned long long maxBytes)
+{
+    std::vector<std::tuple<time_t, unsigned long long, std::string>> entries;
+    unsigned long long totalBytes = 0;
+
+    try {
+        Glib::Dir cacheDir(dir);
+
+        for (const auto& name : cacheDir) {
+            if (name.size() <= cacheExtension.size() || name.compare(name.size() - cacheExtension.size(), cacheExtension.size(), cacheExtension) != 0) {
+                continue;
+            }
+
+            const std::string path = Glib::build_filename(dir, name);
+            GStatBuf st;
+
+            if (g_stat(path.c_str(), &st) == 0) {
+                entries.emplace_back(st.st_mtime, st.st_size, path);
+                totalBytes += st.st_size;
+            }
+        }
+    } catch (Glib::Error&) {
+        return;
+    }
+
+    if (totalBytes <= maxBytes) {
+        return;
+    }
+
+    // least recently used first
+    std::sort(entries.begin(), entries.end());
+
+    for (const auto& entry : entries) {
+        if (totalBytes <= maxBytes) {
+            break;
+        }
+
+        if (g_remove(std::get<2>(entry).c_str()) == 0) {
+            totalBytes -= std::get<1>(entry);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <glibmm.h>
+
+#include "array2D.h"
+#include "noncopyable.h"
+#include "procparams.h"
+
+#include "../rtgui/threadutils.h"
+
+namespace rtengine
+{
+
+/**
+  * On-disk cache of the demosaiced red/green/blue planes of raw images.
+  *
+  * Entries are stored as half floats in settings->demosaicCacheDir and the least recently used ones
+  * are removed as soon as the cache grows beyond settings->demosaicCacheSize MB (0 disables the cache).
+  */
+class DemosaicCache final :
+    public NonCopyable
+{
+public:
+    static DemosaicCache& getInstance();
+
+    bool isEnabled() const;
+
+    /** Returns the part of the key which depends on the preprocessing parameters. */
+    static std::string getPreprocessKey(const procparams::RAWParams& raw, const procparams::LensProfParams& lensProf, const procparams::CoarseTransformParams& coarse);
+    /** Returns the cache key of the demosaiced planes of frame @frame of file @fname, or an empty string if the file can't be identified. */
+    static std::string getKey(const Glib::ustring& fname, unsigned int frame, const std::string& preprocessKey, const procparams::RAWParams& raw);
+
+    bool load(const std::string& key, int width, int height, array2D<float>& red, array2D<float>& green, array2D<float>& blue);
+    void store(const std::string& key, int width, int height, const array2D<float>& red, const array2D<float>& green, const array2D<float>& blue);
+
+private:
+    DemosaicCache() = default;
+
+    Glib::ustring getFileName(const std::string& key) const;
+    void trim(const Glib::ustring& dir, unsigned long long maxBytes);
+
+    MyMutex mutex;
+};
+
+}
@@ -98,31 +98,26 @@ void CLASS init_fuji_compr (struct fuji_compressed_params* info)
     }
 }
 
-#define FUJI_BUF_SIZE 0x10000u
+namespace {
+
+// served once a strip has consumed all of its data
+const DCraw::uchar fujiZeroBytes[16] = {};
+
+}
 
 void CLASS fuji_fill_buffer (struct fuji_compressed_block *info)
 {
     if (info->cur_pos >= info->cur_buf_size) {
         info->cur_pos = 0;
         info->cur_buf_offset += info->cur_buf_size;
-#ifdef MYFILE_MMAP
+        // the whole file is held in memory (mapped or copied), so every strip reads
+        // its own slice of it directly and no locking is needed
         info->cur_buf_size = info->max_read_size;
-        info->cur_buf = fdata(info->cur_buf_offset, info->input);
-#else
-#ifdef _OPENMP
-        #pragma omp critical
-#endif
-        {
-            fseek (info->input, info->cur_buf_offset, SEEK_SET);
-            info->cur_buf_size = fread (info->cur_buf, 1, std::min (info->max_read_size, FUJI_BUF_SIZE), info->input);
-        }
-#endif
-        if (info->cur_buf_size < 1) { // nothing read
-            if (info->fillbytes > 0) {
-                int ls = std::max (1, std::min (info->fillbytes, (int)FUJI_BUF_SIZE));
-                memset (info->cur_buf, 0, ls);
-                info->fillbytes -= ls;
-            }
+
+        if (info->cur_buf_size < 1) { // nothing left to read
+            info->cur_buf = fujiZeroBytes;
+        } else {
+            info->cur_buf = fdata(info->cur_buf_offset, info->input);
         }
 
         info->max_read_size -= info->cur_buf_size;
@@ -137,7 +132,6 @@ void CLASS init_fuji_block (struct fuji_compressed_block* info, const struct fuj
     info->input = ifp;
     INT64 fsize = info->input->size;
     info->max_read_size = std::min (unsigned (fsize - raw_offset), dsize + 16); // Data size may be incorrect?
-    info->fillbytes = 1;
 
     info->linebuf[_R0] = info->linealloc;
 
@@ -146,10 +140,6 @@ void CLASS init_fuji_block (struct fuji_compressed_block* info, const struct fuj
     }
 
     // init buffer
-#ifndef MYFILE_MMAP
-    info->cur_buf = (uchar*)malloc (FUJI_BUF_SIZE);
-    merror (info->cur_buf, "init_fuji_block()");
-#endif
     info->cur_bit = 0;
     info->cur_pos = 0;
     info->cur_buf_offset = raw_offset;
@@ -892,9 +882,6 @@ void CLASS fuji_decode_strip (const struct fuji_compressed_params* info_common,
 
     // release data
     free (info.linealloc);
-#ifndef MYFILE_MMAP
-    free (info.cur_buf);
-#endif
 }
 
 static unsigned sgetn (int n, uchar *s)
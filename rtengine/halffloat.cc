@@ -0,0 +1,107 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "halffloat.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALF_F16C
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+#ifdef HALF_F16C
+
+// the F16C versions are compiled for processors with F16C whatever the target processor, and chosen at run time
+
+__attribute__((target("avx,f16c"))) void floatToHalfF16C(const float* src, std::uint16_t* dst, int n, float scale)
+{
+    const __m256 scalev = _mm256_set1_ps(scale);
+    int i = 0;
+
+    for (; i < n - 7; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_mul_ps(_mm256_loadu_ps(src + i), scalev), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+
+    for (; i < n; ++i) {
+        dst[i] = rtengine::floatToHalf(src[i] * scale);
+    }
+}
+
+__attribute__((target("avx,f16c"))) void halfToFloatF16C(const std::uint16_t* src, float* dst, int n, float scale)
+{
+    const __m256 scalev = _mm256_set1_ps(scale);
+    int i = 0;
+
+    for (; i < n - 7; i += 8) {
+        const __m256 f = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(f, scalev));
+    }
+
+    for (; i < n; ++i) {
+        dst[i] = rtengine::halfToFloat(src[i]) * scale;
+    }
+}
+
+bool hasF16C()
+{
+    static const bool result = __builtin_cpu_supports("f16c");
+    return result;
+}
+
+#endif
+
+}
+
+namespace rtengine
+{
+
+void floatToHalf(const float* src, std::uint16_t* dst, int n, float scale)
+{
+#ifdef HALF_F16C
+
+    if (hasF16C()) {
+        floatToHalfF16C(src, dst, n, scale);
+        return;
+    }
+
+#endif
+
+    for (int i = 0; i < n; ++i) {
+        dst[i] = floatToHalf(src[i] * scale);
+    }
+}
+
+void halfToFloat(const std::uint16_t* src, float* dst, int n, float scale)
+{
+#ifdef HALF_F16C
+
+    if (hasF16C()) {
+        halfToFloatF16C(src, dst, n, scale);
+        return;
+    }
+
+#endif
+
+    for (int i = 0; i < n; ++i) {
+        dst[i] = halfToFloat(src[i]) * scale;
+    }
+}
+
+}
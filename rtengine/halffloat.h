@@ -0,0 +1,97 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace rtengine
+{
+
+// Conversion between float and IEEE 754 half precision (binary16), rounding to nearest even
+
+inline std::uint16_t floatToHalf(float f)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+
+    const std::uint32_t sign = (bits >> 16) & 0x8000;
+    const std::uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x47800000) { // >= 65536, inf or nan
+        return sign | (absBits > 0x7f800000 ? 0x7e00 : 0x7c00);
+    }
+
+    if (absBits < 0x38800000) { // half subnormal or zero
+        if (absBits < 0x33000000) { // rounds to zero
+            return sign;
+        }
+
+        const std::uint32_t shift = 126 - (absBits >> 23);
+        const std::uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+        std::uint32_t h = mantissa >> shift;
+        const std::uint32_t rem = mantissa & ((1u << shift) - 1);
+        const std::uint32_t halfway = 1u << (shift - 1);
+
+        if (rem > halfway || (rem == halfway && (h & 1))) {
+            ++h;
+        }
+
+        return sign | h;
+    }
+
+    std::uint32_t h = (absBits - 0x38000000) >> 13;
+    const std::uint32_t rem = absBits & 0x1fff;
+
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) {
+        ++h; // may carry into the exponent, which is correct
+    }
+
+    return sign | h;
+}
+
+inline float halfToFloat(std::uint16_t h)
+{
+    const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000) << 16;
+    const std::uint32_t exponent = (h >> 10) & 0x1f;
+    const std::uint32_t mantissa = h & 0x3ff;
+    std::uint32_t bits;
+
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa) {
+        const float value = mantissa * (1.f / 16777216.f);
+        return sign ? -value : value;
+    } else {
+        bits = sign;
+    }
+
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Conversion of rows, the values being multiplied by scale. They use the F16C instructions when the processor has them,
+// the results are the same as those of the functions above
+
+void floatToHalf(const float* src, std::uint16_t* dst, int n, float scale);
+void halfToFloat(const std::uint16_t* src, float* dst, int n, float scale);
+
+}
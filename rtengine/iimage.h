@@ -23,6 +23,7 @@
 #include <vector>
 #include "rt_math.h"
 #include "alignedbuffer.h"
+#include "memorybudget.h"
 #include "imagedimensions.h"
 #include "LUT.h"
 #include "coord2d.h"
@@ -591,8 +592,8 @@ class PlanarRGBData : virtual public ImageDatas
 private:
     AlignedBuffer<T> abData;
 
-    int rowstride;    // Plan size, in bytes (all padding bytes included)
-    int planestride;  // Row length, in bytes (padding bytes included)
+    int rowstride;    // Row length, in bytes (padding bytes included)
+    int planestride;  // Plane size, in bytes (all padding bytes included)
 protected:
     T* data;
 
@@ -601,13 +602,20 @@ public:
     PlanarPtr<T> g;
     PlanarPtr<T> b;
 
-    PlanarRGBData() : rowstride(0), planestride(0), data (nullptr) {}
-    PlanarRGBData(int w, int h) : rowstride(0), planestride(0), data (nullptr)
+    PlanarRGBData() : abData(0, 16, true), rowstride(0), planestride(0), data (nullptr) {}
+    PlanarRGBData(int w, int h) : abData(0, 16, true), rowstride(0), planestride(0), data (nullptr)
     {
         allocate(w, h);
     }
 
+    ~PlanarRGBData()
+    {
+        MemoryBudget::getInstance().released(abData.getSize());
+    }
+
     // Send back the row stride. WARNING: unit = byte, not element!
+    // Rows of >8 bits data start on a 64 bytes boundary, so kernels can use aligned vector loads up to AVX-512,
+    // and threads writing adjacent rows don't share cache lines
     int getRowStride ()
     {
         return rowstride;
@@ -655,6 +663,8 @@ public:
             return;
         }
 
+        MemoryBudget::getInstance().released(abData.getSize());
+
         width = W;
         height = H;
 #if CHECK_BOUNDS
@@ -667,8 +677,8 @@ public:
 #endif
 
         if (sizeof(T) > 1) {
-            // 128 bits memory alignment for >8bits data
-            rowstride = ( width * sizeof(T) + 15 ) / 16 * 16;
+            // 64 bytes memory alignment of the rows for >8bits data (the BufferPool aligns the buffer itself)
+            rowstride = ( width * sizeof(T) + 63 ) / 64 * 64;
             planestride = rowstride * height;
         } else {
             // No memory alignment for 8bits data
@@ -676,7 +686,7 @@ public:
             planestride = rowstride * height;
         }
 
-        // find the padding length to ensure a 128 bits alignment for each row
+        // find the padding length to ensure a 64 bytes alignment for each row
         size_t size = (size_t)rowstride * 3 * (size_t)height;
 
         if (!width) {
@@ -689,6 +699,7 @@ public:
                 && g.resize(height)
                 && b.resize(height) ) {
             data   = abData.data;
+            MemoryBudget::getInstance().allocated(abData.getSize());
         } else {
             // asking for a new size of 0 is safe and will free memory, if any!
             abData.resize(0);
@@ -1749,8 +1760,9 @@ public:
       * @param fname is the name of the file
       * @param compression is the amount of compression (0-6), -1 corresponds to the default
       * @param bps can be 8 or 16 depending on the bits per pixels the output file will have
+      * @param threads is the number of threads used to compress the data, 0 = all available
         @return the error code, 0 if none */
-    virtual int saveAsPNG  (Glib::ustring fname, int compression = -1, int bps = -1) = 0;
+    virtual int saveAsPNG  (Glib::ustring fname, int compression = -1, int bps = -1, int threads = 0) = 0;
     /** @brief Saves the image to file in a jpg format.
       * @param fname is the name of the file
       * @param quality is the quality of the jpeg (0...100), set it to -1 to use default
@@ -1759,8 +1771,10 @@ public:
     /** @brief Saves the image to file in a tif format.
       * @param fname is the name of the file
       * @param bps can be 8 or 16 depending on the bits per pixels the output file will have
+      * @param uncompressed disables the compression of the data
+      * @param threads is the number of threads used to compress the data, 0 = all available
         @return the error code, 0 if none */
-    virtual int saveAsTIFF (Glib::ustring fname, int bps = -1, bool uncompressed = false) = 0;
+    virtual int saveAsTIFF (Glib::ustring fname, int bps = -1, bool uncompressed = false, int threads = 0) = 0;
     /** @brief Sets the progress listener if you want to follow the progress of the image saving operations (optional).
       * @param pl is the pointer to the class implementing the ProgressListener interface */
     virtual void setSaveProgressListener (ProgressListener* pl) = 0;
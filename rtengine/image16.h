@@ -17,7 +17,7 @@
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
 //
-// A class representing a 16 bit rgb image with separate planes and 16 byte aligned data
+// A class representing a 16 bit rgb image with separate planes and 64 byte aligned rows
 //
 #ifndef _IMAGE16_
 #define _IMAGE16_
@@ -75,17 +75,17 @@ public:
     {
         return save (fname);
     }
-    virtual int          saveAsPNG  (Glib::ustring fname, int compression = -1, int bps = -1)
+    virtual int          saveAsPNG  (Glib::ustring fname, int compression = -1, int bps = -1, int threads = 0)
     {
-        return savePNG (fname, compression, bps);
+        return savePNG (fname, compression, bps, threads);
     }
     virtual int          saveAsJPEG (Glib::ustring fname, int quality = 100, int subSamp = 3)
     {
         return saveJPEG (fname, quality, subSamp);
     }
-    virtual int          saveAsTIFF (Glib::ustring fname, int bps = -1, bool uncompressed = false)
+    virtual int          saveAsTIFF (Glib::ustring fname, int bps = -1, bool uncompressed = false, int threads = 0)
     {
-        return saveTIFF (fname, bps, uncompressed);
+        return saveTIFF (fname, bps, uncompressed, threads);
     }
     virtual void         setSaveProgressListener (ProgressListener* pl)
     {
@@ -18,11 +18,14 @@
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <png.h>
+#include <zlib.h>
 #include <glib/gstdio.h>
 #include <tiff.h>
 #include <tiffio.h>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
 #include <fcntl.h>
 #include <libiptcdata/iptc-jpeg.h>
 #include "rt_math.h"
@@ -42,6 +45,10 @@
 
 #include "jpeg.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace rtengine;
 using namespace rtengine::procparams;
@@ -84,6 +91,118 @@ Glib::ustring to_utf8 (const std::string& str)
     }
 }
 
+// Size of the independently compressed blocks of the parallel TIFF and PNG encoders
+constexpr int encoderBlockBytes = 1 << 20;
+
+int getEncoderThreads (int threads)
+{
+#ifdef _OPENMP
+    return threads > 0 ? threads : omp_get_max_threads ();
+#else
+    return 1;
+#endif
+}
+
+void swapBytes16 (unsigned char* buffer, int length)
+{
+    for (int i = 0; i < length; i += 2) {
+        std::swap (buffer[i], buffer[i + 1]);
+    }
+}
+
+// Applies the PNG filter which minimizes the sum of absolute differences, like libpng does by default.
+// out receives the filter type followed by the filtered row.
+void pngFilterRow (const unsigned char* row, const unsigned char* prev, int rowlen, int bpp, unsigned char* out, std::vector<unsigned char>& candidate)
+{
+    candidate.resize (rowlen + 1);
+    unsigned long bestSum = ~0ul;
+
+    for (int filter = 0; filter < 5; ++filter) {
+        candidate[0] = filter;
+        unsigned long sum = 0;
+
+        for (int i = 0; i < rowlen; ++i) {
+            const int a = i >= bpp ? row[i - bpp] : 0;
+            const int b = prev ? prev[i] : 0;
+            const int c = prev && i >= bpp ? prev[i - bpp] : 0;
+            int predictor;
+
+            switch (filter) {
+                case 1: // Sub
+                    predictor = a;
+                    break;
+
+                case 2: // Up
+                    predictor = b;
+                    break;
+
+                case 3: // Average
+                    predictor = (a + b) / 2;
+                    break;
+
+                case 4: { // Paeth
+                    const int pa = std::abs (b - c);
+                    const int pb = std::abs (a - c);
+                    const int pc = std::abs (a + b - 2 * c);
+                    predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                    break;
+                }
+
+                default: // None
+                    predictor = 0;
+            }
+
+            const unsigned char value = row[i] - predictor;
+            candidate[i + 1] = value;
+            sum += value < 128 ? value : 256 - value;
+        }
+
+        if (sum < bestSum) {
+            bestSum = sum;
+            std::copy (candidate.begin (), candidate.end (), out);
+        }
+    }
+}
+
+// Compresses a block of the zlib stream of a PNG as raw deflate data. All blocks but the last one end with a sync flush,
+// so that the concatenation of the blocks is a valid deflate stream (same approach as pigz).
+bool deflateBlock (const unsigned char* data, size_t length, int level, bool last, std::vector<unsigned char>& out)
+{
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+
+    if (deflateInit2 (&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED) != Z_OK) {
+        return false;
+    }
+
+    out.resize (deflateBound (&strm, length) + 16);
+    strm.next_in = const_cast<Bytef*> (data);
+    strm.avail_in = length;
+    strm.next_out = out.data ();
+    strm.avail_out = out.size ();
+
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int ret;
+
+    do {
+        if (strm.avail_out == 0) {
+            const size_t done = out.size ();
+            out.resize (done * 2);
+            strm.next_out = out.data () + done;
+            strm.avail_out = out.size () - done;
+        }
+
+        ret = deflate (&strm, flush);
+    } while (ret == Z_OK && (last || strm.avail_out == 0));
+
+    out.resize (strm.total_out);
+    deflateEnd (&strm);
+
+    return last ? ret == Z_STREAM_END : ret == Z_OK && strm.avail_in == 0;
+}
+
 }
 
 Glib::ustring ImageIO::errorMsg[6] = {"Success", "Cannot read file.", "Invalid header.", "Error while reading header.", "File reading error", "Image format not supported."};
@@ -905,7 +1024,7 @@ int ImageIO::loadPPMFromMemory(const char* buffer, int width, int height, bool s
     return IMIO_SUCCESS;
 }
 
-int ImageIO::savePNG  (Glib::ustring fname, int compression, volatile int bps)
+int ImageIO::savePNG  (Glib::ustring fname, int compression, volatile int bps, int threads)
 {
     if (getWidth() < 1 || getHeight() < 1) {
         return IMIO_HEADERERROR;
@@ -963,6 +1082,112 @@ int ImageIO::savePNG  (Glib::ustring fname, int compression, volatile int bps)
 
     png_write_info(png, info);
 
+    const int numThreads = std::min (getEncoderThreads (threads), height);
+
+    if (numThreads > 1) {
+        // Blocks of rows are filtered and compressed in parallel, then written in order as IDAT chunks.
+        // The compressed blocks are joined by sync flushes, so the file is a standard PNG file.
+        const int bpp = 3 * bps / 8;
+        const int blockRows = std::max (1, encoderBlockBytes / (rowlen + 1));
+        const int numBlocks = (height + blockRows - 1) / blockRows;
+        const int level = compression < 0 ? Z_DEFAULT_COMPRESSION : std::min (compression, 9);
+
+        // zlib header, see RFC 1950
+        const int flevel = (level == Z_DEFAULT_COMPRESSION || level == 6) ? 2 : level < 2 ? 0 : level < 6 ? 1 : 3;
+        unsigned char header[2] = {0x78, static_cast<unsigned char> (flevel << 6)};
+        header[1] += 31 - (header[0] * 256 + header[1]) % 31;
+        png_write_chunk (png, reinterpret_cast<png_const_bytep> ("IDAT"), header, 2);
+
+        std::vector<std::vector<unsigned char>> compressed (numThreads);
+        std::vector<uLong> blockAdler (numThreads);
+        std::vector<size_t> blockLength (numThreads);
+        std::vector<char> blockOk (numThreads);
+        uLong adler = adler32 (0L, Z_NULL, 0);
+        bool writeOk = true;
+
+        for (int firstBlock = 0; firstBlock < numBlocks && writeOk; firstBlock += numThreads) {
+            const int lastBlock = std::min (firstBlock + numThreads, numBlocks);
+
+#ifdef _OPENMP
+            #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+#endif
+
+            for (int block = firstBlock; block < lastBlock; ++block) {
+                const int rowStart = block * blockRows;
+                const int rowEnd = std::min (rowStart + blockRows, height);
+                std::vector<unsigned char> prev (rowlen), cur (rowlen), candidate;
+                std::vector<unsigned char> filtered (static_cast<size_t> (rowEnd - rowStart) * (rowlen + 1));
+
+                for (int i = std::max (rowStart - 1, 0); i < rowEnd; ++i) {
+                    getScanline (i, cur.data (), bps);
+
+#if __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+
+                    if (bps == 16) {
+                        // convert to network byte order
+                        swapBytes16 (cur.data (), rowlen);
+                    }
+
+#endif
+
+                    if (i >= rowStart) {
+                        pngFilterRow (cur.data (), i > 0 ? prev.data () : nullptr, rowlen, bpp, &filtered[static_cast<size_t> (i - rowStart) * (rowlen + 1)], candidate);
+                    }
+
+                    std::swap (prev, cur);
+                }
+
+                const int index = block - firstBlock;
+                blockAdler[index] = adler32 (adler32 (0L, Z_NULL, 0), filtered.data (), filtered.size ());
+                blockLength[index] = filtered.size ();
+                blockOk[index] = deflateBlock (filtered.data (), filtered.size (), level, block == numBlocks - 1, compressed[index]);
+            }
+
+            for (int block = firstBlock; block < lastBlock && writeOk; ++block) {
+                const int index = block - firstBlock;
+
+                if (!blockOk[index]) {
+                    writeOk = false;
+                    break;
+                }
+
+                png_write_chunk (png, reinterpret_cast<png_const_bytep> ("IDAT"), compressed[index].data (), compressed[index].size ());
+                adler = adler32_combine (adler, blockAdler[index], blockLength[index]);
+            }
+
+            if (pl) {
+                pl->setProgress (static_cast<double> (lastBlock) / numBlocks);
+            }
+        }
+
+        if (!writeOk) {
+            png_destroy_write_struct (&png, &info);
+            delete [] row;
+            fclose (file);
+            g_remove (fname.c_str ());
+            return IMIO_CANNOTWRITEFILE;
+        }
+
+        const unsigned char trailer[4] = {
+            static_cast<unsigned char> (adler >> 24), static_cast<unsigned char> (adler >> 16),
+            static_cast<unsigned char> (adler >> 8), static_cast<unsigned char> (adler)
+        };
+        png_write_chunk (png, reinterpret_cast<png_const_bytep> ("IDAT"), trailer, 4);
+        // libpng doesn't know about the IDAT chunks written above, so the end chunk is written directly
+        png_write_chunk (png, reinterpret_cast<png_const_bytep> ("IEND"), nullptr, 0);
+        png_destroy_write_struct (&png, &info);
+
+        delete [] row;
+        fclose (file);
+
+        if (pl) {
+            pl->setProgressStr ("PROGRESSBAR_READY");
+            pl->setProgress (1.0);
+        }
+
+        return IMIO_SUCCESS;
+    }
+
     for (int i = 0; i < height; i++) {
         getScanline (i, row, bps);
 
@@ -1192,7 +1417,7 @@ int ImageIO::saveJPEG (Glib::ustring fname, int quality, int subSamp)
     return IMIO_SUCCESS;
 }
 
-int ImageIO::saveTIFF (Glib::ustring fname, int bps, bool uncompressed)
+int ImageIO::saveTIFF (Glib::ustring fname, int bps, bool uncompressed, int threads)
 {
     if (getWidth() < 1 || getHeight() < 1) {
         return IMIO_HEADERERROR;
@@ -1354,7 +1579,10 @@ int ImageIO::saveTIFF (Glib::ustring fname, int bps, bool uncompressed)
         TIFFSetField (out, TIFFTAG_IMAGELENGTH, height);
         TIFFSetField (out, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
         TIFFSetField (out, TIFFTAG_SAMPLESPERPIXEL, 3);
-        TIFFSetField (out, TIFFTAG_ROWSPERSTRIP, height);
+        const int numThreads = uncompressed ? 1 : std::min (getEncoderThreads (threads), height);
+        // strips are compressed independently, so several threads can compress them
+        const int rowsPerStrip = numThreads > 1 ? std::max (1, encoderBlockBytes / lineWidth) : height;
+        TIFFSetField (out, TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
         TIFFSetField (out, TIFFTAG_BITSPERSAMPLE, bps);
         TIFFSetField (out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
         TIFFSetField (out, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
@@ -1369,17 +1597,66 @@ int ImageIO::saveTIFF (Glib::ustring fname, int bps, bool uncompressed)
             TIFFSetField (out, TIFFTAG_ICCPROFILE, profileLength, profileData);
         }
 
-        for (int row = 0; row < height; row++) {
-            getScanline (row, linebuffer, bps);
+        if (numThreads > 1) {
+            const int numStrips = (height + rowsPerStrip - 1) / rowsPerStrip;
+            // libtiff swaps the bytes of scanlines when needed, but not the ones of raw strips
+            const bool needsReverse = bps == 16 && TIFFIsByteSwapped (out);
+            std::vector<std::vector<unsigned char>> compressed (numThreads);
+            std::vector<char> stripOk (numThreads);
+
+            for (int firstStrip = 0; firstStrip < numStrips && writeOk; firstStrip += numThreads) {
+                const int lastStrip = std::min (firstStrip + numThreads, numStrips);
+
+#ifdef _OPENMP
+                #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+#endif
+
+                for (int strip = firstStrip; strip < lastStrip; ++strip) {
+                    const int rowStart = strip * rowsPerStrip;
+                    const int rows = std::min (rowsPerStrip, height - rowStart);
+                    std::vector<unsigned char> data (static_cast<size_t> (rows) * lineWidth);
+
+                    for (int i = 0; i < rows; ++i) {
+                        getScanline (rowStart + i, &data[static_cast<size_t> (i) * lineWidth], bps);
+
+                        if (needsReverse) {
+                            swapBytes16 (&data[static_cast<size_t> (i) * lineWidth], lineWidth);
+                        }
+                    }
 
-            if (TIFFWriteScanline (out, linebuffer, row, 0) < 0) {
-                TIFFClose (out);
-                delete [] linebuffer;
-                return IMIO_CANNOTWRITEFILE;
+                    std::vector<unsigned char>& dst = compressed[strip - firstStrip];
+                    uLongf dstLength = compressBound (data.size ());
+                    dst.resize (dstLength);
+                    stripOk[strip - firstStrip] = compress2 (dst.data (), &dstLength, data.data (), data.size (), Z_DEFAULT_COMPRESSION) == Z_OK;
+                    dst.resize (dstLength);
+                }
+
+                for (int strip = firstStrip; strip < lastStrip; ++strip) {
+                    std::vector<unsigned char>& dst = compressed[strip - firstStrip];
+
+                    if (!stripOk[strip - firstStrip] || TIFFWriteRawStrip (out, strip, dst.data (), dst.size ()) < 0) {
+                        writeOk = false;
+                        break;
+                    }
+                }
+
+                if (pl) {
+                    pl->setProgress (static_cast<double> (lastStrip) / numStrips);
+                }
             }
+        } else {
+            for (int row = 0; row < height; row++) {
+                getScanline (row, linebuffer, bps);
 
-            if (pl && !(row % 100)) {
-                pl->setProgress ((double)(row + 1) / height);
+                if (TIFFWriteScanline (out, linebuffer, row, 0) < 0) {
+                    TIFFClose (out);
+                    delete [] linebuffer;
+                    return IMIO_CANNOTWRITEFILE;
+                }
+
+                if (pl && !(row % 100)) {
+                    pl->setProgress ((double)(row + 1) / height);
+                }
             }
         }
 
@@ -31,6 +31,7 @@
 #include "image8.h"
 #include "image16.h"
 #include "imagefloat.h"
+#include "canceltoken.h"
 
 namespace rtengine
 {
@@ -60,15 +61,33 @@ protected:
     FramesData* idata;
     ImageMatrices imatrices;
     double dirpyrdenoiseExpComp;
+    const CancelToken* cancelToken; // polled by the heavy operations of the interactive pipeline, may be null
 
 public:
     ImageSource () : references (1), redAWBMul(-1.), greenAWBMul(-1.), blueAWBMul(-1.),
-        embProfile(nullptr), idata(nullptr), dirpyrdenoiseExpComp(INFINITY) {}
+        embProfile(nullptr), idata(nullptr), dirpyrdenoiseExpComp(INFINITY), cancelToken(nullptr) {}
 
     virtual ~ImageSource            () {}
+    void                setCancelToken (const CancelToken* token)
+    {
+        cancelToken = token;
+    }
     virtual int         load        (const Glib::ustring &fname, int imageNum = 0, bool batch = false) = 0;
     virtual void        preprocess  (const RAWParams &raw, const LensProfParams &lensProf, const CoarseTransformParams& coarse, bool prepareDenoise = true) {};
     virtual void        demosaic    (const RAWParams &raw) {};
+    // true if demosaicRegion can bring the given method to parts of an image demosaiced with another one
+    virtual bool        canDemosaicRegion (const RAWParams &raw) const
+    {
+        return false;
+    }
+    // demosaic the part of the image needed by getImage for pp with the method of raw, if not already done
+    virtual void        demosaicRegion    (const RAWParams &raw, int tran, const PreviewProps &pp) {};
+    // averages the colors of the raw data in the pp.getSkip() sized blocks read by getImage for pp, which then only
+    // gives correct results for pp. Returns false if the sensor or the method don't allow it
+    virtual bool        demosaicBinned    (const RAWParams &raw, int tran, const PreviewProps &pp)
+    {
+        return false;
+    }
     virtual void        retinex       (ColorManagementParams cmp, const RetinexParams &deh, ToneCurveParams Tc, LUTf & cdcurve, LUTf & mapcurve, const RetinextransmissionCurve & dehatransmissionCurve, const RetinexgaintransmissionCurve & dehagaintransmissionCurve, multi_array2D<float, 4> &conversionBuffer, bool dehacontlutili, bool mapcontlutili, bool useHsl, float &minCD, float &maxCD, float &mini, float &maxi, float &Tmean, float &Tsigma, float &Tmin, float &Tmax, LUTu &histLRETI) {};
     virtual void        retinexPrepareCurves       (const RetinexParams &retinexParams, LUTf &cdcurve, LUTf &mapcurve, RetinextransmissionCurve &retinextransmissionCurve, RetinexgaintransmissionCurve &retinexgaintransmissionCurve, bool &retinexcontlutili, bool &mapcontlutili, bool &useHsl, LUTu & lhist16RETI, LUTu & histLRETI) {};
     virtual void        retinexPrepareBuffers      (ColorManagementParams cmp, const RetinexParams &retinexParams, multi_array2D<float, 4> &conversionBuffer, LUTu &lhist16RETI) {};
@@ -154,6 +173,14 @@ public:
     {
         return idata;
     }
+    virtual unsigned long long getDataSize ()
+    {
+        int w = 0, h = 0;
+        getFullSize (w, h);
+        // raw files hold one float per pixel and frame, other images three floats per pixel
+        const unsigned long long pixelBytes = isRAW () ? sizeof (float) * (getFrameCount () > 1 ? getFrameCount () : 1) : 3 * sizeof (float);
+        return static_cast<unsigned long long> (w) * h * pixelBytes;
+    }
     virtual ImageSource* getImageSource ()
     {
         return this;
@@ -35,7 +35,7 @@ extern const Settings* settings;
 ImProcCoordinator::ImProcCoordinator ()
     : orig_prev (nullptr), oprevi (nullptr), oprevl (nullptr), nprevl (nullptr), previmg (nullptr), workimg (nullptr),
       ncie (nullptr), imgsrc (nullptr), shmap (nullptr), lastAwbEqual (0.), lastAwbTempBias (0.0), ipf (&params, true), monitorIntent (RI_RELATIVE),
-      softProof (false), gamutCheck (false), scale (10), highDetailPreprocessComputed (false), highDetailRawComputed (false),
+      softProof (false), gamutCheck (false), scale (10), highDetailPreprocessComputed (false), highDetailRawComputed (false), regionDemosaic (false),
       allocated (false), bwAutoR (-9000.f), bwAutoG (-9000.f), bwAutoB (-9000.f), CAMMean (NAN),
 
       hltonecurve (65536),
@@ -91,11 +91,14 @@ ImProcCoordinator::ImProcCoordinator ()
       plistener (nullptr), imageListener (nullptr), aeListener (nullptr), acListener (nullptr), abwListener (nullptr), awbListener (nullptr), frameCountListener (nullptr), imageTypeListener (nullptr), actListener (nullptr), adnListener (nullptr), awavListener (nullptr), dehaListener (nullptr), hListener (nullptr),
       resultValid (false), lastOutputProfile ("BADFOOD"), lastOutputIntent (RI__COUNT), lastOutputBPC (false), thread (nullptr), changeSinceLast (0), updaterRunning (false), destroying (false), utili (false), autili (false),
       butili (false), ccutili (false), cclutili (false), clcutili (false), opautili (false), wavcontlutili (false), colourToningSatLimit (0.f), colourToningSatLimitOpacity (0.f)
-{}
+{
+    ipf.setCancelToken (&cancelToken);
+}
 
 void ImProcCoordinator::assign (ImageSource* imgsrc)
 {
     this->imgsrc = imgsrc;
+    imgsrc->setCancelToken (&cancelToken);
 }
 
 ImProcCoordinator::~ImProcCoordinator ()
@@ -118,6 +121,7 @@ ImProcCoordinator::~ImProcCoordinator ()
         delete toDel[i];
     }
 
+    imgsrc->setCancelToken (nullptr);
     imgsrc->decreaseRef ();
     updaterThreadStart.unlock ();
 }
@@ -153,14 +157,21 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
     }
 
     // Check if any detail crops need high detail. If not, take a fast path short cut
+    bool cropsNeedDetail = false;
+
     if (!highDetailNeeded) {
         for (size_t i = 0; i < crops.size(); i++)
             if (crops[i]->get_skip() == 1 ) {  // skip=1 -> full resolution
-                highDetailNeeded = true;
+                highDetailNeeded = cropsNeedDetail = true;
                 break;
             }
     }
 
+    // When only the detail crops need high detail, they demosaic their own area if the method allows it.
+    // Retinex and the Color highlight recovery work on the whole rgb data, so they need a full demosaic
+    regionDemosaic = cropsNeedDetail && imgsrc->canDemosaicRegion (params.raw) && !params.retinex.enabled
+                     && !(params.toneCurve.hrenabled && params.toneCurve.method == "Color");
+
     RAWParams rp = params.raw;
     ColorManagementParams cmp = params.icm;
     LCurveParams  lcur = params.labCurve;
@@ -219,23 +230,30 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
     }
 
     if (   (todo & M_RAW)
-            || (!highDetailRawComputed && highDetailNeeded)
+            || (!highDetailRawComputed && highDetailNeeded && !regionDemosaic)
             || ( params.toneCurve.hrenabled && params.toneCurve.method != "Color" && imgsrc->isRGBSourceModified())
             || (!params.toneCurve.hrenabled && params.toneCurve.method == "Color" && imgsrc->isRGBSourceModified())) {
 
+        RAWParams dp = rp;
+
+        if (regionDemosaic) {
+            // the preview only needs the fast method, the crops ask for the rest in Crop::update
+            dp.bayersensor.method = RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::fast];
+        }
+
         if (settings->verbose) {
             if (imgsrc->getSensorType() == ST_BAYER) {
-                printf ("Demosaic Bayer image n.%d using method: %s\n", rp.bayersensor.imageNum + 1, rp.bayersensor.method.c_str());
+                printf ("Demosaic Bayer image n.%d using method: %s\n", dp.bayersensor.imageNum + 1, dp.bayersensor.method.c_str());
             } else if (imgsrc->getSensorType() == ST_FUJI_XTRANS) {
-                printf ("Demosaic X-Trans image with using method: %s\n", rp.xtranssensor.method.c_str());
+                printf ("Demosaic X-Trans image with using method: %s\n", dp.xtranssensor.method.c_str());
             }
         }
 
-        imgsrc->demosaic ( rp); //enabled demosaic
+        imgsrc->demosaic ( dp); //enabled demosaic
         // if a demosaic happened we should also call getimage later, so we need to set the M_INIT flag
         todo |= M_INIT;
 
-        if (highDetailNeeded) {
+        if (highDetailNeeded && !regionDemosaic) {
             highDetailRawComputed = true;
         } else {
             highDetailRawComputed = false;
@@ -260,6 +278,10 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
         float minCD, maxCD, mini, maxi, Tmean, Tsigma, Tmin, Tmax;
         imgsrc->retinex ( params.icm, params.retinex,  params.toneCurve, cdcurve, mapcurve, dehatransmissionCurve, dehagaintransmissionCurve, conversionBuffer, dehacontlutili, mapcontlutili, useHsl, minCD, maxCD, mini, maxi, Tmean, Tsigma, Tmin, Tmax, histLRETI); //enabled Retinex
 
+        if (ipf.isCancelled ()) {
+            return;
+        }
+
         if (dehaListener) {
             dehaListener->minmaxChanged (maxCD, minCD, mini, maxi, Tmean, Tsigma, Tmin, Tmax);
         }
@@ -383,6 +405,10 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
         ipf.firstAnalysis (orig_prev, params, vhist16);
     }
 
+    if (ipf.isCancelled ()) {
+        return;
+    }
+
     readyphase++;
 
     progress ("Rotate / Distortion...", 100 * readyphase / numofphases);
@@ -626,18 +652,34 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
                                        params.labCurve.lccurve, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, scale == 1 ? 1 : 16);
     }
 
-    if (todo & (M_LUMINANCE + M_COLOR) ) {
-        nprevl->CopyFrom (oprevl);
+    if (todo & M_LABSTAGES) {
+        // The output of a stage is only cached if one of the following stages has something to do
+        const bool cbdlEnabled = params.dirpyrequalizer.enabled && params.dirpyrequalizer.cbdlMethod == "aft" && !(params.colorappearance.enabled && settings->autocielab);
+        const LabStageCache::Stage firstStage = labStages.begin (todo, oprevl, nprevl);
+
+        // give a quick feedback when slow stages have to be applied
+        if (options.progressivePreview && resultValid && imageListener && !params.colorappearance.enabled
+                && ((firstStage <= LabStageCache::COLOR && params.epd.enabled) || (firstStage <= LabStageCache::CBDL && cbdlEnabled) || (firstStage <= LabStageCache::WAVELET && params.wavelet.enabled))) {
+            showCoarsePreview (firstStage);
+        }
 
-        progress ("Applying Color Boost...", 100 * readyphase / numofphases);
-        //   ipf.MSR(nprevl, nprevl->W, nprevl->H, 1);
-        histCCurve.clear();
-        histLCurve.clear();
-        ipf.chromiLuminanceCurve (nullptr, pW, nprevl, nprevl, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, clcurve, lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, histCCurve, histLCurve);
-        ipf.vibrance (nprevl);
+        if (firstStage <= LabStageCache::COLOR) {
+            progress ("Applying Color Boost...", 100 * readyphase / numofphases);
+            //   ipf.MSR(nprevl, nprevl->W, nprevl->H, 1);
+            histCCurve.clear();
+            histLCurve.clear();
+            ipf.chromiLuminanceCurve (nullptr, pW, nprevl, nprevl, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, clcurve, lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, histCCurve, histLCurve);
+            ipf.vibrance (nprevl);
+
+            if ((params.colorappearance.enabled && !params.colorappearance.tonecie) ||  (!params.colorappearance.enabled)) {
+                ipf.EPDToneMap (nprevl, 5, scale);
+            }
+
+            if (ipf.isCancelled ()) {
+                return;
+            }
 
-        if ((params.colorappearance.enabled && !params.colorappearance.tonecie) ||  (!params.colorappearance.enabled)) {
-            ipf.EPDToneMap (nprevl, 5, scale);
+            labStages.store (LabStageCache::COLOR, nprevl, cbdlEnabled || params.wavelet.enabled || params.colorappearance.enabled);
         }
 
         // for all treatments Defringe, Sharpening, Contrast detail , Microcontrast they are activated if "CIECAM" function are disabled
@@ -683,31 +725,40 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
                     }
                 }
         */
-        if (params.dirpyrequalizer.cbdlMethod == "aft") {
+        if (firstStage <= LabStageCache::CBDL && params.dirpyrequalizer.cbdlMethod == "aft") {
             if (((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)) ) {
                 progress ("Pyramid wavelet...", 100 * readyphase / numofphases);
                 ipf.dirpyrequalizer (nprevl, scale);
                 //ipf.Lanczoslab (ip_wavelet(LabImage * lab, LabImage * dst, const procparams::EqualizerParams & eqparams), nprevl, 1.f/scale);
                 readyphase++;
             }
+
+            labStages.store (LabStageCache::CBDL, nprevl, cbdlEnabled && (params.wavelet.enabled || params.colorappearance.enabled));
         }
 
 
-        wavcontlutili = false;
-        //CurveFactory::curveWavContL ( wavcontlutili,params.wavelet.lcurve, wavclCurve, LUTu & histogramwavcl, LUTu & outBeforeWavCLurveHistogram,int skip);
-        CurveFactory::curveWavContL (wavcontlutili, params.wavelet.wavclCurve, wavclCurve, scale == 1 ? 1 : 16);
+        if (firstStage <= LabStageCache::WAVELET) {
+            wavcontlutili = false;
+            //CurveFactory::curveWavContL ( wavcontlutili,params.wavelet.lcurve, wavclCurve, LUTu & histogramwavcl, LUTu & outBeforeWavCLurveHistogram,int skip);
+            CurveFactory::curveWavContL (wavcontlutili, params.wavelet.wavclCurve, wavclCurve, scale == 1 ? 1 : 16);
 
 
-        if ((params.wavelet.enabled)) {
-            WaveletParams WaveParams = params.wavelet;
-            //      WaveParams.getCurves(wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY);
-            WaveParams.getCurves (wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL);
+            if ((params.wavelet.enabled)) {
+                WaveletParams WaveParams = params.wavelet;
+                //      WaveParams.getCurves(wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY);
+                WaveParams.getCurves (wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL);
 
-            int kall = 0;
-            progress ("Wavelet...", 100 * readyphase / numofphases);
-            //  ipf.ip_wavelet(nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, scale);
-            ipf.ip_wavelet (nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL, wavclCurve, wavcontlutili, scale);
+                int kall = 0;
+                progress ("Wavelet...", 100 * readyphase / numofphases);
+                //  ipf.ip_wavelet(nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, scale);
+                ipf.ip_wavelet (nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL, wavclCurve, wavcontlutili, scale);
 
+                if (ipf.isCancelled ()) {
+                    return;
+                }
+            }
+
+            labStages.store (LabStageCache::WAVELET, nprevl, params.wavelet.enabled && params.colorappearance.enabled);
         }
 
 
@@ -828,6 +879,11 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
             crops[i]->update (todo);    // may call ourselves
         }
 
+    // a cancelled update is restarted by ImProcCoordinator::process, the preview would only show stale data
+    if (ipf.isCancelled ()) {
+        return;
+    }
+
     progress ("Conversion to RGB...", 100 * readyphase / numofphases);
 
     if ((todo != CROP && todo != MINUPDATE) || (todo & M_MONITOR)) {
@@ -870,6 +926,94 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
 }
 
 
+/* Applies the Lab stages starting at firstStage to a downscaled copy of nprevl, and shows the result
+ * in the preview before the stages are applied at the preview scale. CIECAM isn't supported.
+ */
+void ImProcCoordinator::showCoarsePreview (LabStageCache::Stage firstStage)
+{
+    constexpr int factor = 4;
+    const int cW = pW / factor;
+    const int cH = pH / factor;
+
+    if (cW < 16 || cH < 16) {
+        return;
+    }
+
+    LabImage coarse (cW, cH);
+    constexpr float norm = 1.f / (factor * factor);
+
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+
+    for (int i = 0; i < cH; i++) {
+        for (int j = 0; j < cW; j++) {
+            float L = 0.f, a = 0.f, b = 0.f;
+
+            for (int k = i * factor; k < (i + 1) * factor; k++) {
+                for (int l = j * factor; l < (j + 1) * factor; l++) {
+                    L += nprevl->L[k][l];
+                    a += nprevl->a[k][l];
+                    b += nprevl->b[k][l];
+                }
+            }
+
+            coarse.L[i][j] = L * norm;
+            coarse.a[i][j] = a * norm;
+            coarse.b[i][j] = b * norm;
+        }
+    }
+
+    const int coarseScale = scale * factor;
+
+    if (firstStage <= LabStageCache::COLOR) {
+        LUTu dummy;
+        ipf.chromiLuminanceCurve (nullptr, 1, &coarse, &coarse, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, clcurve, lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, dummy, dummy);
+        ipf.vibrance (&coarse);
+        ipf.EPDToneMap (&coarse, 5, coarseScale);
+    }
+
+    if (firstStage <= LabStageCache::CBDL && params.dirpyrequalizer.cbdlMethod == "aft") {
+        ipf.dirpyrequalizer (&coarse, coarseScale);
+    }
+
+    if (firstStage <= LabStageCache::WAVELET && params.wavelet.enabled) {
+        CurveFactory::curveWavContL (wavcontlutili, params.wavelet.wavclCurve, wavclCurve, 16);
+        WaveletParams WaveParams = params.wavelet;
+        WaveParams.getCurves (wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL);
+        ipf.ip_wavelet (&coarse, &coarse, 0, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL, wavclCurve, wavcontlutili, coarseScale);
+    }
+
+    if (ipf.isCancelled ()) {
+        return;
+    }
+
+    Image8 coarseImg (cW, cH);
+    ipf.lab2monitorRgb (&coarse, &coarseImg);
+
+    {
+        MyMutex::MyLock prevImgLock (previmg->getMutex());
+
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+
+        for (int i = 0; i < pH; i++) {
+            const unsigned char* src = coarseImg.data + 3 * min (i / factor, cH - 1) * cW;
+            unsigned char* dst = previmg->data + 3 * i * pW;
+
+            for (int j = 0; j < pW; j++) {
+                const int sj = 3 * min (j / factor, cW - 1);
+                dst[3 * j] = src[sj];
+                dst[3 * j + 1] = src[sj + 1];
+                dst[3 * j + 2] = src[sj + 2];
+            }
+        }
+    }
+
+    imageListener->imageReady (params.crop);
+}
+
 void ImProcCoordinator::freeAll ()
 {
 
@@ -889,6 +1033,7 @@ void ImProcCoordinator::freeAll ()
         oprevl    = nullptr;
         delete nprevl;
         nprevl    = nullptr;
+        labStages.clear ();
 
         if (ncie) {
             delete ncie;
@@ -1327,6 +1472,11 @@ void ImProcCoordinator::startProcessing (int changeCode)
 {
     paramsUpdateMutex.lock();
     changeSinceLast |= changeCode;
+
+    if (changeCode & ~M_VOID) {
+        cancelToken.cancel ();
+    }
+
     paramsUpdateMutex.unlock();
 
     startProcessing ();
@@ -1344,14 +1494,20 @@ void ImProcCoordinator::process ()
         params = nextParams;
         int change = changeSinceLast;
         changeSinceLast = 0;
+        cancelToken.reset ();
         paramsUpdateMutex.unlock ();
 
-        // M_VOID means no update, and is a bit higher that the rest
-        if (change & (M_VOID - 1)) {
+        // M_VOID means no update, any other bit (including the Lab stage bits above it) requires one
+        if (change & ~M_VOID) {
             updatePreviewImage (change);
         }
 
         paramsUpdateMutex.lock ();
+
+        if (cancelToken.isCancelled ()) {
+            // newer parameters arrived while updating, the steps of the cancelled update have to be done again with them
+            changeSinceLast |= change;
+        }
     }
 
     paramsUpdateMutex.unlock ();
@@ -1378,6 +1534,11 @@ void ImProcCoordinator::endUpdateParams (int changeFlags)
 {
     changeSinceLast |= changeFlags;
 
+    // don't waste time on an update whose result would be outdated
+    if (changeFlags & ~M_VOID) {
+        cancelToken.cancel ();
+    }
+
     paramsUpdateMutex.unlock ();
     startProcessing ();
 }
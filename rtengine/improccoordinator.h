@@ -24,6 +24,7 @@
 #include "image8.h"
 #include "image16.h"
 #include "imagesource.h"
+#include "labstagecache.h"
 #include "procevents.h"
 #include "dcrop.h"
 #include "LUT.h"
@@ -57,6 +58,7 @@ protected:
     Imagefloat *oprevi;
     LabImage *oprevl;
     LabImage *nprevl;
+    LabStageCache labStages;  // cached outputs of the stages applied to nprevl
     Image8 *previmg;  // displayed image in monitor color space, showing the output profile as well (soft-proofing enabled, which then correspond to workimg) or not
     Image8 *workimg;  // internal image in output color space for analysis
     CieImage *ncie;
@@ -81,6 +83,7 @@ protected:
     int scale;
     bool highDetailPreprocessComputed;
     bool highDetailRawComputed;
+    bool regionDemosaic;  // the detail windows demosaic their own area, the full frame got the fast method
     bool allocated;
 
     void freeAll ();
@@ -180,6 +183,7 @@ protected:
     void updateLRGBHistograms ();
     void setScale (int prevscale);
     void updatePreviewImage (int todo, Crop* cropCall = nullptr);
+    void showCoarsePreview (LabStageCache::Stage firstStage);
 
     MyMutex mProcessing;
     ProcParams params;
@@ -196,6 +200,7 @@ protected:
     MyMutex updaterThreadStart;
     MyMutex paramsUpdateMutex;
     int  changeSinceLast;
+    CancelToken cancelToken; // raised when new parameters supersede the running update
     bool updaterRunning;
     ProcParams nextParams;
     bool destroying;
@@ -6671,6 +6671,7 @@ void ImProcFunctions::EPDToneMap (LabImage *lab, unsigned int Iterates, int skip
     float *b = lab->b[0];
     size_t N = lab->W * lab->H;
     EdgePreservingDecomposition epd (lab->W, lab->H);
+    epd.setCancelToken (cancelToken);
 
     //Due to the taking of logarithms, L must be nonnegative. Further, scale to 0 to 1 using nominal range of L, 0 to 15 bit.
     float minL = FLT_MAX;
@@ -6736,6 +6737,10 @@ void ImProcFunctions::EPDToneMap (LabImage *lab, unsigned int Iterates, int skip
     fwrite(L, N, sizeof(float), f);
     fclose(f);*/
 
+    if (isCancelled()) {
+        return;
+    }
+
     epd.CompressDynamicRange (L, sca / float (skip), edgest, Compression, DetailBoost, Iterates, rew);
 
     //Restore past range, also desaturate a bit per Mantiuk's Color correction for tone mapping.
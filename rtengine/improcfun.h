@@ -34,6 +34,8 @@
 #include "curves.h"
 #include "cplx_wavelet_dec.h"
 #include "pipettebuffer.h"
+#include "canceltoken.h"
+#include "resampler.h"
 
 namespace rtengine
 {
@@ -51,6 +53,7 @@ class ImProcFunctions
     const ProcParams* params;
     double scale;
     bool multiThread;
+    const CancelToken* cancelToken;
 
     void calcVignettingParams (int oW, int oH, const VignettingParams& vignetting, double &w2, double &h2, double& maxRadius, double &v, double &b, double &mul);
 
@@ -79,19 +82,9 @@ class ImProcFunctions
 
     inline void interpolateTransformCubic (Imagefloat* src, int xs, int ys, double Dx, double Dy, float *r, float *g, float *b, double mul)
     {
-        const double A = -0.85;
-
         double w[4];
 
-        {
-            double t1, t2;
-            t1 = -A * (Dx - 1.0) * Dx;
-            t2 = (3.0 - 2.0 * Dx) * Dx * Dx;
-            w[3] = t1 * Dx;
-            w[2] = t1 * (Dx - 1.0) + t2;
-            w[1] = -t1 * Dx + 1.0 - t2;
-            w[0] = -t1 * (Dx - 1.0);
-        }
+        Resampler::cubicWeights (Dx, w);
 
         double rd, gd, bd;
         double yr[4] = {0.0}, yg[4] = {0.0}, yb[4] = {0.0};
@@ -111,16 +104,7 @@ class ImProcFunctions
         }
 
 
-        {
-            double t1, t2;
-
-            t1 = -A * (Dy - 1.0) * Dy;
-            t2 = (3.0 - 2.0 * Dy) * Dy * Dy;
-            w[3] = t1 * Dy;
-            w[2] = t1 * (Dy - 1.0) + t2;
-            w[1] = -t1 * Dy + 1.0 - t2;
-            w[0] = -t1 * (Dy - 1.0);
-        }
+        Resampler::cubicWeights (Dy, w);
 
         rd = gd = bd = 0.0;
 
@@ -140,19 +124,9 @@ class ImProcFunctions
 
     inline void interpolateTransformChannelsCubic (float** src, int xs, int ys, double Dx, double Dy, float *r, double mul)
     {
-        const double A = -0.85;
-
         double w[4];
 
-        {
-            double t1, t2;
-            t1 = -A * (Dx - 1.0) * Dx;
-            t2 = (3.0 - 2.0 * Dx) * Dx * Dx;
-            w[3] = t1 * Dx;
-            w[2] = t1 * (Dx - 1.0) + t2;
-            w[1] = -t1 * Dx + 1.0 - t2;
-            w[0] = -t1 * (Dx - 1.0);
-        }
+        Resampler::cubicWeights (Dx, w);
 
         double rd;
         double yr[4] = {0.0};
@@ -168,15 +142,7 @@ class ImProcFunctions
         }
 
 
-        {
-            double t1, t2;
-            t1 = -A * (Dy - 1.0) * Dy;
-            t2 = (3.0 - 2.0 * Dy) * Dy * Dy;
-            w[3] = t1 * Dy;
-            w[2] = t1 * (Dy - 1.0) + t2;
-            w[1] = -t1 * Dy + 1.0 - t2;
-            w[0] = -t1 * (Dy - 1.0);
-        }
+        Resampler::cubicWeights (Dy, w);
 
         rd = 0.0;
 
@@ -201,10 +167,19 @@ public:
     double lumimul[3];
 
     ImProcFunctions       (const ProcParams* iparams, bool imultiThread = true)
-        : monitorTransform (nullptr), lab2outputTransform (nullptr), output2monitorTransform (nullptr), params (iparams), scale (1), multiThread (imultiThread), lumimul{} {}
+        : monitorTransform (nullptr), lab2outputTransform (nullptr), output2monitorTransform (nullptr), params (iparams), scale (1), multiThread (imultiThread), cancelToken (nullptr), lumimul{} {}
     ~ImProcFunctions      ();
     bool needsLuminanceOnly() { return !(needsCA() || needsDistortion() || needsRotation() || needsPerspective() || needsLCP() || needsLensfun()) && (needsVignetting() || needsPCVignetting() || needsGradient());}
     void setScale         (double iscale);
+    void setCancelToken   (const CancelToken* token)
+    {
+        cancelToken = token;
+    }
+    // true if the current processing has been superseded, the heavy kernels then return early
+    bool isCancelled      () const
+    {
+        return cancelToken && cancelToken->isCancelled();
+    }
 
     bool needsTransform   ();
     bool needsPCVignetting ();
@@ -244,7 +219,7 @@ public:
     float resizeScale     (const ProcParams* params, int fw, int fh, int &imw, int &imh);
     void lab2monitorRgb   (LabImage* lab, Image8* image);
     void resize           (Image16* src, Image16* dst, float dScale);
-    void Lanczos (const LabImage* src, LabImage* dst, float scale);
+    void Lanczos (const LabImage* src, LabImage* dst, float scale, bool boxPrescale = false);
     void Lanczos (const Image16* src, Image16* dst, float scale);
 
     void deconvsharpening (float** luminance, float** buffer, int W, int H, const SharpeningParams &sharpenParam);
@@ -16,6 +16,8 @@
  *  You should have received a copy of the GNU General Public License
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cstdio>
+
 #include "../rtgui/profilestorecombobox.h"
 #include "rtengine.h"
 #include "iccstore.h"
@@ -31,6 +33,8 @@
 #include "profilestore.h"
 #include "../rtgui/threadutils.h"
 #include "rtlensfun.h"
+#include "memorybudget.h"
+#include "cpudispatch.h"
 
 namespace rtengine
 {
@@ -42,6 +46,7 @@ MyMutex* lcmsMutex = nullptr;
 int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDir, bool loadAll)
 {
     settings = s;
+    MemoryBudget::getInstance().setLimit (s->memoryBudget > 0 ? std::size_t (s->memoryBudget) << 20 : 0);
     ProcParams::init();
     PerceptualToneCurve::init();
     RawImageSource::init();
@@ -99,6 +104,11 @@ int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDi
 }
 
     Color::init ();
+
+    if (s->verbose) {
+        printf ("Demosaic kernels: %s\n", getDispatchedSimdPath ());
+    }
+
     delete lcmsMutex;
     lcmsMutex = new MyMutex;
     return 0;
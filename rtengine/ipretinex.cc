@@ -398,6 +398,10 @@ void RawImageSource::MSR(float** luminance, float** originalLuminance, float **e
             float *buffer = new float[W_L * H_L];;
 
             for ( int scale = scal - 1; scale >= 0; scale-- ) {
+                if(cancelToken && cancelToken->isCancelled()) {
+                    break;
+                }
+
 #ifdef _OPENMP
                 #pragma omp parallel
 #endif
@@ -24,6 +24,7 @@
 #include "mytime.h"
 #include "rt_math.h"
 #include "sleef.c"
+#include "opthelper.h"
 #include "rtlensfun.h"
 
 
@@ -723,6 +724,217 @@ void ImProcFunctions::transformLuminanceOnly (Imagefloat* original, Imagefloat*
 }
 
 
+namespace
+{
+
+constexpr int transformGridStep = 16;           // initial spacing of the nodes of the displacement grid
+constexpr int transformGridMinStep = 4;         // below that the exact model is cheaper
+constexpr double transformGridMaxError = 0.05;  // max deviation from the exact model, in pixels
+
+// maps the output pixels of transformGeneral to the source image
+struct TransformModel {
+    const LensCorrection *pLCPMap;
+    bool enableLCPDist, enableLCPCA, needsDist, needsPerspective, needsVignetting;
+    int cx, cy;
+    double ascale, w2, h2, vig_w2, vig_h2, maxRadius;
+    double chDist[3], distAmount;
+    double cost, sint;
+    double vpcospt, vptanpt, hpcospt, hptanpt;
+
+    // source coordinates of output pixel x, y in the first nc channels, and the radius used by the vignetting correction
+    void map (double x, double y, int nc, double Dx[3], double Dy[3], double &vigR) const
+    {
+        double x_d = x, y_d = y;
+
+        if (enableLCPDist) {
+            pLCPMap->correctDistortion (x_d, y_d, cx, cy, ascale); // must be first transform
+        } else {
+            x_d *= ascale;
+            y_d *= ascale;
+        }
+
+        x_d += ascale * (cx - w2);     // centering x coord & scale
+        y_d += ascale * (cy - h2);     // centering y coord & scale
+
+        if (needsPerspective) {
+            // horizontal perspective transformation
+            y_d *= maxRadius / (maxRadius + x_d * hptanpt);
+            x_d *= maxRadius * hpcospt / (maxRadius + x_d * hptanpt);
+
+            // vertical perspective transformation
+            x_d *= maxRadius / (maxRadius - y_d * vptanpt);
+            y_d *= maxRadius * vpcospt / (maxRadius - y_d * vptanpt);
+        }
+
+        // rotate
+        double Dxc = x_d * cost - y_d * sint;
+        double Dyc = x_d * sint + y_d * cost;
+
+        // distortion correction
+        double s = 1;
+
+        if (needsDist) {
+            double r = sqrt (Dxc * Dxc + Dyc * Dyc) / maxRadius; // sqrt is slow
+            s = 1.0 - distAmount + distAmount * r ;
+        }
+
+        vigR = 0.;
+
+        if (needsVignetting) {
+            double vig_x_d = ascale * (x + cx - vig_w2);       // centering x coord & scale
+            double vig_y_d = ascale * (y + cy - vig_h2);       // centering y coord & scale
+            double vig_Dx = vig_x_d * cost - vig_y_d * sint;
+            double vig_Dy = vig_x_d * sint + vig_y_d * cost;
+            vigR = s * sqrt (vig_Dx * vig_Dx + vig_Dy * vig_Dy);
+        }
+
+        for (int c = 0; c < nc; c++) {
+            // de-center
+            Dx[c] = Dxc * (s + chDist[c]) + w2;
+            Dy[c] = Dyc * (s + chDist[c]) + h2;
+
+            // LCP CA
+            if (enableLCPCA) {
+                pLCPMap->correctCA (Dx[c], Dy[c], c);
+            }
+        }
+    }
+};
+
+// TransformModel sampled every step pixels, bilinearly interpolated in between
+class DisplacementGrid
+{
+    int step;
+    int gridW, gridH;  // number of nodes
+    int planes;        // x and y of each channel, then the vignetting radius
+    std::vector<float> nodes;
+
+    bool sample (const TransformModel &model, int W, int H, int nc, bool multiThread)
+    {
+        gridW = (W - 1) / step + 2;
+        gridH = (H - 1) / step + 2;
+        nodes.resize (planes * gridW * gridH);
+        const int planeSize = gridW * gridH;
+
+        #pragma omp parallel for if (multiThread)
+
+        for (int gy = 0; gy < gridH; gy++) {
+            for (int gx = 0; gx < gridW; gx++) {
+                double Dx[3], Dy[3], vigR;
+                model.map (gx * step, gy * step, nc, Dx, Dy, vigR);
+
+                for (int c = 0; c < nc; c++) {
+                    nodes[(2 * c) * planeSize + gy * gridW + gx] = Dx[c];
+                    nodes[(2 * c + 1) * planeSize + gy * gridW + gx] = Dy[c];
+                }
+
+                nodes[2 * nc * planeSize + gy * gridW + gx] = vigR;
+            }
+        }
+
+        // bound the interpolation error at the cell centers, where it is the largest
+        double maxError = 0.;
+
+        #pragma omp parallel if (multiThread)
+        {
+            double threadMaxError = 0.;
+
+            #pragma omp for nowait
+
+            for (int gy = 0; gy < gridH - 1; gy++) {
+                for (int gx = 0; gx < gridW - 1; gx++) {
+                    double Dx[3], Dy[3], vigR;
+                    model.map ((gx + 0.5) * step, (gy + 0.5) * step, nc, Dx, Dy, vigR);
+
+                    for (int p = 0; p < 2 * nc; p++) {
+                        const float *n = &nodes[p * planeSize + gy * gridW + gx];
+                        const double interpolated = 0.25 * ((double)n[0] + n[1] + n[gridW] + n[gridW + 1]);
+                        threadMaxError = std::max (threadMaxError, fabs ((p & 1 ? Dy[p / 2] : Dx[p / 2]) - interpolated));
+                    }
+                }
+            }
+
+            #pragma omp critical
+            maxError = std::max (maxError, threadMaxError);
+        }
+
+        return maxError <= transformGridMaxError;
+    }
+
+public:
+    DisplacementGrid () : step (0), gridW (0), gridH (0), planes (0) {}
+
+    // returns false if even the finest grid deviates too much from the model
+    bool build (const TransformModel &model, int W, int H, int nc, bool multiThread)
+    {
+        planes = 2 * nc + 1;
+
+        for (step = transformGridStep; step >= transformGridMinStep; step /= 2) {
+            if (sample (model, W, H, nc, multiThread)) {
+                return true;
+            }
+        }
+
+        nodes.clear();
+        return false;
+    }
+
+    // length of a row of each plane, a multiple of the step
+    int getRowLength () const
+    {
+        return (gridW - 1) * step;
+    }
+
+    int getRowSize () const
+    {
+        return planes * getRowLength();
+    }
+
+    // interpolates the row y of all the planes into row, which holds getRowSize() floats
+    void getRow (int y, float *row) const
+    {
+        const int gy = y / step;
+        const float fy = (float) (y - gy * step) / step;
+        const int planeSize = gridW * gridH;
+        const int rowLength = getRowLength();
+        const float invStep = 1.f / step;
+#ifdef __SSE2__
+        const vfloat offsetv = _mm_set_ps (3.f, 2.f, 1.f, 0.f);
+#endif
+
+        for (int p = 0; p < planes; p++) {
+            const float *top = &nodes[p * planeSize + gy * gridW];
+            const float *bottom = top + gridW;
+            float *out = row + p * rowLength;
+            float left = top[0] + fy * (bottom[0] - top[0]);
+
+            for (int gx = 0; gx < gridW - 1; gx++) {
+                const float right = top[gx + 1] + fy * (bottom[gx + 1] - top[gx + 1]);
+                const float delta = (right - left) * invStep;
+                float *cell = out + gx * step;
+#ifdef __SSE2__
+                const vfloat leftv = F2V (left);
+                const vfloat deltav = F2V (delta);
+
+                for (int k = 0; k < step; k += 4) {
+                    STVFU (cell[k], leftv + (offsetv + F2V ((float)k)) * deltav);
+                }
+
+#else
+
+                for (int k = 0; k < step; k++) {
+                    cell[k] = left + k * delta;
+                }
+
+#endif
+                left = right;
+            }
+        }
+    }
+};
+
+}
+
 void ImProcFunctions::transformGeneral(ImProcFunctions::TransformMode mode, Imagefloat *original, Imagefloat *transformed, int cx, int cy, int sx, int sy, int oW, int oH, int fW, int fH, const LensCorrection *pLCPMap)
 {
     double w2 = (double) oW  / 2.0 - 0.5;
@@ -753,35 +965,48 @@ void ImProcFunctions::transformGeneral(ImProcFunctions::TransformMode mode, Imag
     chTrans[1] = transformed->g.ptrs;
     chTrans[2] = transformed->b.ptrs;
 
+    TransformModel model;
+    model.pLCPMap = pLCPMap;
+    model.cx = cx;
+    model.cy = cy;
+    model.w2 = w2;
+    model.h2 = h2;
+    model.vig_w2 = vig_w2;
+    model.vig_h2 = vig_h2;
+    model.maxRadius = maxRadius;
+
     // auxiliary variables for c/a correction
-    double chDist[3];
-    chDist[0] = params->cacorrection.red;
-    chDist[1] = 0.0;
-    chDist[2] = params->cacorrection.blue;
+    model.chDist[0] = params->cacorrection.red;
+    model.chDist[1] = 0.0;
+    model.chDist[2] = params->cacorrection.blue;
 
     // auxiliary variables for distortion correction
-    bool needsDist = needsDistortion();  // for performance
-    double distAmount = params->distortion.amount;
+    model.needsDist = needsDistortion();  // for performance
+    model.distAmount = params->distortion.amount;
 
     // auxiliary variables for rotation
-    double cost = cos (params->rotate.degree * rtengine::RT_PI / 180.0);
-    double sint = sin (params->rotate.degree * rtengine::RT_PI / 180.0);
+    model.cost = cos (params->rotate.degree * rtengine::RT_PI / 180.0);
+    model.sint = sin (params->rotate.degree * rtengine::RT_PI / 180.0);
 
     // auxiliary variables for vertical perspective correction
     double vpdeg = params->perspective.vertical / 100.0 * 45.0;
     double vpalpha = (90.0 - vpdeg) / 180.0 * rtengine::RT_PI;
     double vpteta  = fabs (vpalpha - rtengine::RT_PI / 2) < 3e-4 ? 0.0 : acos ((vpdeg > 0 ? 1.0 : -1.0) * sqrt ((-SQR (oW * tan (vpalpha)) + (vpdeg > 0 ? 1.0 : -1.0) *
                      oW * tan (vpalpha) * sqrt (SQR (4 * maxRadius) + SQR (oW * tan (vpalpha)))) / (SQR (maxRadius) * 8)));
-    double vpcospt = (vpdeg >= 0 ? 1.0 : -1.0) * cos (vpteta), vptanpt = tan (vpteta);
+    model.vpcospt = (vpdeg >= 0 ? 1.0 : -1.0) * cos (vpteta);
+    model.vptanpt = tan (vpteta);
 
     // auxiliary variables for horizontal perspective correction
     double hpdeg = params->perspective.horizontal / 100.0 * 45.0;
     double hpalpha = (90.0 - hpdeg) / 180.0 * rtengine::RT_PI;
     double hpteta  = fabs (hpalpha - rtengine::RT_PI / 2) < 3e-4 ? 0.0 : acos ((hpdeg > 0 ? 1.0 : -1.0) * sqrt ((-SQR (oH * tan (hpalpha)) + (hpdeg > 0 ? 1.0 : -1.0) *
                      oH * tan (hpalpha) * sqrt (SQR (4 * maxRadius) + SQR (oH * tan (hpalpha)))) / (SQR (maxRadius) * 8)));
-    double hpcospt = (hpdeg >= 0 ? 1.0 : -1.0) * cos (hpteta), hptanpt = tan (hpteta);
+    model.hpcospt = (hpdeg >= 0 ? 1.0 : -1.0) * cos (hpteta);
+    model.hptanpt = tan (hpteta);
+    model.needsPerspective = needsPerspective();
+    model.needsVignetting = needsVignetting();
 
-    double ascale = params->commonTrans.autofill ? getTransformAutoFill (oW, oH, pLCPMap) : 1.0;
+    model.ascale = params->commonTrans.autofill ? getTransformAutoFill (oW, oH, pLCPMap) : 1.0;
 
     // smaller crop images are a problem, so only when processing fully
     bool enableLCPCA = false;
@@ -811,142 +1036,127 @@ void ImProcFunctions::transformGeneral(ImProcFunctions::TransformMode mode, Imag
     }
 
     if (!enableCA) {
-        chDist[0] = 0.0;
+        model.chDist[0] = 0.0;
     }
 
-    // main cycle
-    bool darkening = (params->vignetting.amount <= 0.0);
-    #pragma omp parallel for if (multiThread)
-
-    for (int y = 0; y < transformed->getHeight(); y++) {
-        for (int x = 0; x < transformed->getWidth(); x++) {
-            double x_d = x, y_d = y;
-
-            if (enableLCPDist) {
-                pLCPMap->correctDistortion(x_d, y_d, cx, cy, ascale); // must be first transform
-            } else {
-                x_d *= ascale;
-                y_d *= ascale;
-            }
-
-            x_d += ascale * (cx - w2);     // centering x coord & scale
-            y_d += ascale * (cy - h2);     // centering y coord & scale
+    model.enableLCPDist = enableLCPDist;
+    model.enableLCPCA = enableLCPCA;
 
-            double vig_x_d = 0., vig_y_d = 0.;
-
-            if (needsVignetting()) {
-                vig_x_d = ascale * (x + cx - vig_w2);       // centering x coord & scale
-                vig_y_d = ascale * (y + cy - vig_h2);       // centering y coord & scale
-            }
+    const int nc = enableCA ? 3 : 1;
 
-            if (needsPerspective()) {
-                // horizontal perspective transformation
-                y_d *= maxRadius / (maxRadius + x_d * hptanpt);
-                x_d *= maxRadius * hpcospt / (maxRadius + x_d * hptanpt);
+    // the mapping is smooth, so it is sampled on a coarse grid and interpolated, unless the grid can't follow the exact model
+    DisplacementGrid grid;
+    const bool useGrid = grid.build (model, transformed->getWidth(), transformed->getHeight(), nc, multiThread);
 
-                // vertical perspective transformation
-                x_d *= maxRadius / (maxRadius - y_d * vptanpt);
-                y_d *= maxRadius * vpcospt / (maxRadius - y_d * vptanpt);
+    // main cycle
+    bool darkening = (params->vignetting.amount <= 0.0);
+    #pragma omp parallel if (multiThread)
+    {
+        std::vector<float> gridRow (useGrid ? grid.getRowSize() : 0);
+        float* rowX[3];
+        float* rowY[3];
+        float* rowVig = nullptr;
+
+        if (useGrid) {
+            for (int c = 0; c < nc; c++) {
+                rowX[c] = gridRow.data() + (2 * c) * grid.getRowLength();
+                rowY[c] = gridRow.data() + (2 * c + 1) * grid.getRowLength();
             }
 
-            // rotate
-            double Dxc = x_d * cost - y_d * sint;
-            double Dyc = x_d * sint + y_d * cost;
-
-            // distortion correction
-            double s = 1;
-
-            if (needsDist) {
-                double r = sqrt (Dxc * Dxc + Dyc * Dyc) / maxRadius; // sqrt is slow
-                s = 1.0 - distAmount + distAmount * r ;
-            }
+            rowVig = gridRow.data() + 2 * nc * grid.getRowLength();
+        }
 
-            double r2 = 0.;
+        #pragma omp for
 
-            if (needsVignetting()) {
-                double vig_Dx = vig_x_d * cost - vig_y_d * sint;
-                double vig_Dy = vig_x_d * sint + vig_y_d * cost;
-                r2 = sqrt (vig_Dx * vig_Dx + vig_Dy * vig_Dy);
+        for (int y = 0; y < transformed->getHeight(); y++) {
+            if (useGrid) {
+                grid.getRow (y, gridRow.data());
             }
 
-            for (int c = 0; c < (enableCA ? 3 : 1); c++) {
-                double Dx = Dxc * (s + chDist[c]);
-                double Dy = Dyc * (s + chDist[c]);
+            for (int x = 0; x < transformed->getWidth(); x++) {
+                double Dxs[3], Dys[3], vigR;
 
-                // de-center
-                Dx += w2;
-                Dy += h2;
+                if (useGrid) {
+                    for (int c = 0; c < nc; c++) {
+                        Dxs[c] = rowX[c][x];
+                        Dys[c] = rowY[c][x];
+                    }
 
-                // LCP CA
-                if (enableLCPCA) {
-                    pLCPMap->correctCA (Dx, Dy, c);
+                    vigR = rowVig[x];
+                } else {
+                    model.map (x, y, nc, Dxs, Dys, vigR);
                 }
 
-                // Extract integer and fractions of source screen coordinates
-                int xc = (int)Dx;
-                Dx -= (double)xc;
-                xc -= sx;
-                int yc = (int)Dy;
-                Dy -= (double)yc;
-                yc -= sy;
-
-                // Convert only valid pixels
-                if (yc >= 0 && yc < original->getHeight() && xc >= 0 && xc < original->getWidth()) {
-
-                    // multiplier for vignetting correction
-                    double vignmul = 1.0;
-
-                    if (needsVignetting()) {
-                        if (darkening) {
-                            vignmul /= std::max (v + mul * tanh (b * (maxRadius - s * r2) / maxRadius), 0.001);
-                        } else {
-                            vignmul *= (v + mul * tanh (b * (maxRadius - s * r2) / maxRadius));
+                for (int c = 0; c < nc; c++) {
+                    double Dx = Dxs[c];
+                    double Dy = Dys[c];
+
+                    // Extract integer and fractions of source screen coordinates
+                    int xc = (int)Dx;
+                    Dx -= (double)xc;
+                    xc -= sx;
+                    int yc = (int)Dy;
+                    Dy -= (double)yc;
+                    yc -= sy;
+
+                    // Convert only valid pixels
+                    if (yc >= 0 && yc < original->getHeight() && xc >= 0 && xc < original->getWidth()) {
+
+                        // multiplier for vignetting correction
+                        double vignmul = 1.0;
+
+                        if (needsVignetting()) {
+                            if (darkening) {
+                                vignmul /= std::max (v + mul * tanh (b * (maxRadius - vigR) / maxRadius), 0.001);
+                            } else {
+                                vignmul *= (v + mul * tanh (b * (maxRadius - vigR) / maxRadius));
+                            }
                         }
-                    }
 
-                    if (needsGradient()) {
-                        vignmul *= calcGradientFactor (gp, cx + x, cy + y);
-                    }
+                        if (needsGradient()) {
+                            vignmul *= calcGradientFactor (gp, cx + x, cy + y);
+                        }
 
-                    if (needsPCVignetting()) {
-                        vignmul *= calcPCVignetteFactor (pcv, cx + x, cy + y);
-                    }
+                        if (needsPCVignetting()) {
+                            vignmul *= calcPCVignetteFactor (pcv, cx + x, cy + y);
+                        }
 
-                    if (yc > 0 && yc < original->getHeight() - 2 && xc > 0 && xc < original->getWidth() - 2) {
-                        // all interpolation pixels inside image
-                        if (enableCA) {
-                            interpolateTransformChannelsCubic (chOrig[c], xc - 1, yc - 1, Dx, Dy, & (chTrans[c][y][x]), vignmul);
-                        } else if (mode == ImProcFunctions::TRANSFORM_PREVIEW) {
-                            transformed->r (y, x) = vignmul * (original->r (yc, xc) * (1.0 - Dx) * (1.0 - Dy) + original->r (yc, xc + 1) * Dx * (1.0 - Dy) + original->r (yc + 1, xc) * (1.0 - Dx) * Dy + original->r (yc + 1, xc + 1) * Dx * Dy);
-                            transformed->g (y, x) = vignmul * (original->g (yc, xc) * (1.0 - Dx) * (1.0 - Dy) + original->g (yc, xc + 1) * Dx * (1.0 - Dy) + original->g (yc + 1, xc) * (1.0 - Dx) * Dy + original->g (yc + 1, xc + 1) * Dx * Dy);
-                            transformed->b (y, x) = vignmul * (original->b (yc, xc) * (1.0 - Dx) * (1.0 - Dy) + original->b (yc, xc + 1) * Dx * (1.0 - Dy) + original->b (yc + 1, xc) * (1.0 - Dx) * Dy + original->b (yc + 1, xc + 1) * Dx * Dy);
+                        if (yc > 0 && yc < original->getHeight() - 2 && xc > 0 && xc < original->getWidth() - 2) {
+                            // all interpolation pixels inside image
+                            if (enableCA) {
+                                interpolateTransformChannelsCubic (chOrig[c], xc - 1, yc - 1, Dx, Dy, & (chTrans[c][y][x]), vignmul);
+                            } else if (mode == ImProcFunctions::TRANSFORM_PREVIEW) {
+                                transformed->r (y, x) = vignmul * (original->r (yc, xc) * (1.0 - Dx) * (1.0 - Dy) + original->r (yc, xc + 1) * Dx * (1.0 - Dy) + original->r (yc + 1, xc) * (1.0 - Dx) * Dy + original->r (yc + 1, xc + 1) * Dx * Dy);
+                                transformed->g (y, x) = vignmul * (original->g (yc, xc) * (1.0 - Dx) * (1.0 - Dy) + original->g (yc, xc + 1) * Dx * (1.0 - Dy) + original->g (yc + 1, xc) * (1.0 - Dx) * Dy + original->g (yc + 1, xc + 1) * Dx * Dy);
+                                transformed->b (y, x) = vignmul * (original->b (yc, xc) * (1.0 - Dx) * (1.0 - Dy) + original->b (yc, xc + 1) * Dx * (1.0 - Dy) + original->b (yc + 1, xc) * (1.0 - Dx) * Dy + original->b (yc + 1, xc + 1) * Dx * Dy);
+                            } else {
+                                interpolateTransformCubic (original, xc - 1, yc - 1, Dx, Dy, & (transformed->r (y, x)), & (transformed->g (y, x)), & (transformed->b (y, x)), vignmul);
+                            }
                         } else {
-                            interpolateTransformCubic (original, xc - 1, yc - 1, Dx, Dy, & (transformed->r (y, x)), & (transformed->g (y, x)), & (transformed->b (y, x)), vignmul);
+                            // edge pixels
+                            int y1 = LIM (yc,   0, original->getHeight() - 1);
+                            int y2 = LIM (yc + 1, 0, original->getHeight() - 1);
+                            int x1 = LIM (xc,   0, original->getWidth() - 1);
+                            int x2 = LIM (xc + 1, 0, original->getWidth() - 1);
+
+                            if (enableCA) {
+                                chTrans[c][y][x] = vignmul * (chOrig[c][y1][x1] * (1.0 - Dx) * (1.0 - Dy) + chOrig[c][y1][x2] * Dx * (1.0 - Dy) + chOrig[c][y2][x1] * (1.0 - Dx) * Dy + chOrig[c][y2][x2] * Dx * Dy);
+                            } else {
+                                transformed->r (y, x) = vignmul * (original->r (y1, x1) * (1.0 - Dx) * (1.0 - Dy) + original->r (y1, x2) * Dx * (1.0 - Dy) + original->r (y2, x1) * (1.0 - Dx) * Dy + original->r (y2, x2) * Dx * Dy);
+                                transformed->g (y, x) = vignmul * (original->g (y1, x1) * (1.0 - Dx) * (1.0 - Dy) + original->g (y1, x2) * Dx * (1.0 - Dy) + original->g (y2, x1) * (1.0 - Dx) * Dy + original->g (y2, x2) * Dx * Dy);
+                                transformed->b (y, x) = vignmul * (original->b (y1, x1) * (1.0 - Dx) * (1.0 - Dy) + original->b (y1, x2) * Dx * (1.0 - Dy) + original->b (y2, x1) * (1.0 - Dx) * Dy + original->b (y2, x2) * Dx * Dy);
+                            }
                         }
                     } else {
-                        // edge pixels
-                        int y1 = LIM (yc,   0, original->getHeight() - 1);
-                        int y2 = LIM (yc + 1, 0, original->getHeight() - 1);
-                        int x1 = LIM (xc,   0, original->getWidth() - 1);
-                        int x2 = LIM (xc + 1, 0, original->getWidth() - 1);
-
                         if (enableCA) {
-                            chTrans[c][y][x] = vignmul * (chOrig[c][y1][x1] * (1.0 - Dx) * (1.0 - Dy) + chOrig[c][y1][x2] * Dx * (1.0 - Dy) + chOrig[c][y2][x1] * (1.0 - Dx) * Dy + chOrig[c][y2][x2] * Dx * Dy);
+                            // not valid (source pixel x,y not inside source image, etc.)
+                            chTrans[c][y][x] = 0;
                         } else {
-                            transformed->r (y, x) = vignmul * (original->r (y1, x1) * (1.0 - Dx) * (1.0 - Dy) + original->r (y1, x2) * Dx * (1.0 - Dy) + original->r (y2, x1) * (1.0 - Dx) * Dy + original->r (y2, x2) * Dx * Dy);
-                            transformed->g (y, x) = vignmul * (original->g (y1, x1) * (1.0 - Dx) * (1.0 - Dy) + original->g (y1, x2) * Dx * (1.0 - Dy) + original->g (y2, x1) * (1.0 - Dx) * Dy + original->g (y2, x2) * Dx * Dy);
-                            transformed->b (y, x) = vignmul * (original->b (y1, x1) * (1.0 - Dx) * (1.0 - Dy) + original->b (y1, x2) * Dx * (1.0 - Dy) + original->b (y2, x1) * (1.0 - Dx) * Dy + original->b (y2, x2) * Dx * Dy);
+                            transformed->r (y, x) = 0;
+                            transformed->g (y, x) = 0;
+                            transformed->b (y, x) = 0;
                         }
                     }
-                } else {
-                    if (enableCA) {
-                        // not valid (source pixel x,y not inside source image, etc.)
-                        chTrans[c][y][x] = 0;
-                    } else {
-                        transformed->r (y, x) = 0;
-                        transformed->g (y, x) = 0;
-                        transformed->b (y, x) = 0;
-                    }
                 }
             }
         }
@@ -694,6 +694,10 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
 
         for (int tiletop = 0; tiletop < imheight; tiletop += tileHskip) {
             for (int tileleft = 0; tileleft < imwidth ; tileleft += tileWskip) {
+                if(isCancelled()) {
+                    continue;
+                }
+
                 int tileright = MIN(imwidth, tileleft + tilewidth);
                 int tilebottom = MIN(imheight, tiletop + tileheight);
                 int width  = tileright - tileleft;
@@ -979,7 +983,7 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
                     if(levwava > 0) {
                         wavelet_decomposition* adecomp = new wavelet_decomposition (labco->data + datalen, labco->W, labco->H, levwava, 1, skip, max(1, wavNestedLevels), DaubLen );
 
-                        if(!adecomp->memoryAllocationFailed) {
+                        if(!adecomp->memoryAllocationFailed && !isCancelled()) {
                             WaveletcontAllAB(labco, varhue, varchro, *adecomp, waOpacityCurveW, cp, true);
                             adecomp->reconstruct(labco->data + datalen, cp.strength);
                         }
@@ -1000,7 +1004,7 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
                     if(levwavb > 0) {
                         wavelet_decomposition* bdecomp = new wavelet_decomposition (labco->data + 2 * datalen, labco->W, labco->H, levwavb, 1, skip, max(1, wavNestedLevels), DaubLen );
 
-                        if(!bdecomp->memoryAllocationFailed) {
+                        if(!bdecomp->memoryAllocationFailed && !isCancelled()) {
                             WaveletcontAllAB(labco, varhue, varchro, *bdecomp, waOpacityCurveW, cp, false);
                             bdecomp->reconstruct(labco->data + 2 * datalen, cp.strength);
                         }
@@ -1022,7 +1026,7 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
                         wavelet_decomposition* adecomp = new wavelet_decomposition (labco->data + datalen, labco->W, labco->H, levwavab, 1, skip, max(1, wavNestedLevels), DaubLen );
                         wavelet_decomposition* bdecomp = new wavelet_decomposition (labco->data + 2 * datalen, labco->W, labco->H, levwavab, 1, skip, max(1, wavNestedLevels), DaubLen );
 
-                        if(!adecomp->memoryAllocationFailed && !bdecomp->memoryAllocationFailed) {
+                        if(!adecomp->memoryAllocationFailed && !bdecomp->memoryAllocationFailed && !isCancelled()) {
                             WaveletcontAllAB(labco, varhue, varchro, *adecomp, waOpacityCurveW, cp, true);
                             WaveletcontAllAB(labco, varhue, varchro, *bdecomp, waOpacityCurveW, cp, false);
                             WaveletAandBAllAB(labco, varhue, varchro, *adecomp, *bdecomp, cp, waOpacityCurveW, hhCurve, hhutili );
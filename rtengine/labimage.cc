@@ -3,7 +3,7 @@
 namespace rtengine
 {
 
-LabImage::LabImage (int w, int h) : fromImage(false), W(w), H(h)
+LabImage::LabImage (int w, int h, bool alignedRows) : fromImage(false), alignedRows(alignedRows), rowStride(w), W(w), H(h)
 {
     allocLab(w, h);
 }
@@ -15,7 +15,15 @@ LabImage::~LabImage ()
 
 void LabImage::CopyFrom(LabImage *Img)
 {
-    memcpy(data, Img->data, W * H * 3 * sizeof(float));
+    if (rowStride == Img->rowStride) {
+        memcpy(data, Img->data, (size_t)rowStride * H * 3 * sizeof(float));
+    } else {
+        for (int i = 0; i < H; i++) {
+            memcpy(L[i], Img->L[i], W * sizeof(float));
+            memcpy(a[i], Img->a[i], W * sizeof(float));
+            memcpy(b[i], Img->b[i], W * sizeof(float));
+        }
+    }
 }
 
 void LabImage::getPipetteData (float &v1, float &v2, float &v3, int posX, int posY, int squareSize)
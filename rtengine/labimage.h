@@ -19,6 +19,12 @@
 #ifndef _LABIMAGE_H_
 #define _LABIMAGE_H_
 
+#include <memory>
+#include <new>
+
+#include "bufferpool.h"
+#include "memorybudget.h"
+
 namespace rtengine
 {
 
@@ -26,29 +32,45 @@ class LabImage
 {
 private:
     bool fromImage;
+    bool alignedRows;
+    int rowStride; // distance between the start of two rows, in floats
     void allocLab(int w, int h)
     {
-        L = new float*[H];
-        a = new float*[H];
-        b = new float*[H];
+        // 16 floats = 64 bytes: a cache line, and enough for AVX-512 aligned loads
+        rowStride = alignedRows ? (W + 15) / 16 * 16 : W;
+        const size_t planeSize = (size_t)rowStride * H;
+
+        // the row pointers are only handed over once everything is allocated, so that nothing leaks on bad_alloc
+        std::unique_ptr<float*[]> rowsL(new float*[H]);
+        std::unique_ptr<float*[]> rowsA(new float*[H]);
+        std::unique_ptr<float*[]> rowsB(new float*[H]);
+
+        data = static_cast<float*>(BufferPool::getInstance().acquire(sizeof(float) * planeSize * 3));
+
+        if (!data) {
+            throw std::bad_alloc();
+        }
 
-        data = new float [W * H * 3];
+        MemoryBudget::getInstance().allocated(sizeof(float) * planeSize * 3);
+        L = rowsL.release();
+        a = rowsA.release();
+        b = rowsB.release();
         float * index = data;
 
         for (int i = 0; i < H; i++) {
-            L[i] = index + i * W;
+            L[i] = index + i * rowStride;
         }
 
-        index += W * H;
+        index += planeSize;
 
         for (int i = 0; i < H; i++) {
-            a[i] = index + i * W;
+            a[i] = index + i * rowStride;
         }
 
-        index += W * H;
+        index += planeSize;
 
         for (int i = 0; i < H; i++) {
-            b[i] = index + i * W;
+            b[i] = index + i * rowStride;
         }
     };
 public:
@@ -58,9 +80,22 @@ public:
     float** a;
     float** b;
 
-    LabImage (int w, int h);
+    /* With alignedRows, each row starts on a 64 bytes boundary and is padded up to the next one, see getRowStride().
+     * Such an image must only be accessed by rows: the wavelet decomposition, the EPD tone mapping and the other tools
+     * which handle "data" as three packed W*H planes need the default, packed layout. */
+    LabImage (int w, int h, bool alignedRows = false);
     ~LabImage ();
 
+    // Distance between the start of two rows, in floats (not bytes). Equals W unless the rows are aligned.
+    int getRowStride () const
+    {
+        return rowStride;
+    }
+    bool isPacked () const
+    {
+        return rowStride == W;
+    }
+
     //Copies image data in Img into this instance.
     void CopyFrom(LabImage *Img);
     void getPipetteData (float &L, float &a, float &b, int posX, int posY, int squareSize);
@@ -70,7 +105,8 @@ public:
             delete [] L;
             delete [] a;
             delete [] b;
-            delete [] data;
+            BufferPool::getInstance().release(data, sizeof(float) * rowStride * H * 3);
+            MemoryBudget::getInstance().released(sizeof(float) * rowStride * H * 3);
         }
     }
     void reallocLab( )
@@ -0,0 +1,178 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "labstagecache.h"
+
+#include "halffloat.h"
+#include "labimage.h"
+#include "memorybudget.h"
+#include "refreshmap.h"
+#include "settings.h"
+
+namespace
+{
+
+constexpr int stageFlags[rtengine::LabStageCache::NUM_STAGES] = {
+    M_LUMINANCE | M_COLOR,
+    M_SHARPENING,
+    M_CBDL,
+    M_WAVELET,
+    M_CIECAM
+};
+
+// the half floats are stored divided by 16, which leaves room for the values above 65504 of the highlights
+constexpr float storeScale = 1.f / 16.f;
+constexpr float loadScale = 16.f;
+
+}
+
+namespace rtengine
+{
+
+extern const Settings* settings;
+
+LabStageCache::LabStageCache()
+{
+    for (int i = 0; i < NUM_STAGES; ++i) {
+        outputs[i].image = nullptr;
+        outputs[i].W = outputs[i].H = 0;
+        valid[i] = false;
+    }
+}
+
+LabStageCache::~LabStageCache()
+{
+    clear();
+}
+
+LabStageCache::Stage LabStageCache::begin(int todo, LabImage* src, LabImage* dst)
+{
+    int first = 0;
+
+    while (first < NUM_STAGES - 1 && !(todo & stageFlags[first])) {
+        ++first;
+    }
+
+    // the cached outputs of the stages which will be computed again are obsolete
+    for (int i = first; i < NUM_STAGES; ++i) {
+        valid[i] = false;
+    }
+
+    // restart from the last cached output, the stages whose output wasn't kept are computed again
+    int stage = first;
+
+    while (stage > 0 && !(valid[stage - 1] && outputs[stage - 1].W == dst->W && outputs[stage - 1].H == dst->H)) {
+        valid[--stage] = false;
+    }
+
+    if (stage == 0) {
+        dst->CopyFrom(src);
+    } else if (outputs[stage - 1].image) {
+        dst->CopyFrom(outputs[stage - 1].image);
+    } else {
+        const std::uint16_t* const half = outputs[stage - 1].half.data();
+        const std::size_t planeSize = static_cast<std::size_t>(dst->W) * dst->H;
+
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+
+        for (int i = 0; i < dst->H; ++i) {
+            const std::size_t offset = static_cast<std::size_t>(i) * dst->W;
+            halfToFloat(half + offset, dst->L[i], dst->W, loadScale);
+            halfToFloat(half + planeSize + offset, dst->a[i], dst->W, loadScale);
+            halfToFloat(half + 2 * planeSize + offset, dst->b[i], dst->W, loadScale);
+        }
+    }
+
+    return static_cast<Stage>(stage);
+}
+
+void LabStageCache::store(Stage stage, LabImage* img, bool needed)
+{
+    valid[stage] = false;
+
+    if (!needed) {
+        release(stage);
+        return;
+    }
+
+    Output& output = outputs[stage];
+    const bool half = settings->halfFloatStageCache;
+
+    if (output.W != img->W || output.H != img->H || (half ? output.image != nullptr : !output.half.empty())) {
+        release(stage);
+    }
+
+    output.W = img->W;
+    output.H = img->H;
+
+    if (half) {
+        const std::size_t planeSize = static_cast<std::size_t>(img->W) * img->H;
+
+        if (output.half.empty()) {
+            output.half.resize(3 * planeSize);
+            MemoryBudget::getInstance().allocated(3 * planeSize * sizeof(std::uint16_t));
+        }
+
+        std::uint16_t* const dst = output.half.data();
+
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+
+        for (int i = 0; i < img->H; ++i) {
+            const std::size_t offset = static_cast<std::size_t>(i) * img->W;
+            floatToHalf(img->L[i], dst + offset, img->W, storeScale);
+            floatToHalf(img->a[i], dst + planeSize + offset, img->W, storeScale);
+            floatToHalf(img->b[i], dst + 2 * planeSize + offset, img->W, storeScale);
+        }
+    } else {
+        if (!output.image) {
+            output.image = new LabImage(img->W, img->H);
+        }
+
+        output.image->CopyFrom(img);
+    }
+
+    valid[stage] = true;
+}
+
+void LabStageCache::clear()
+{
+    for (int i = 0; i < NUM_STAGES; ++i) {
+        release(static_cast<Stage>(i));
+        valid[i] = false;
+    }
+}
+
+void LabStageCache::release(Stage stage)
+{
+    Output& output = outputs[stage];
+
+    delete output.image;
+    output.image = nullptr;
+
+    if (!output.half.empty()) {
+        MemoryBudget::getInstance().released(output.half.size() * sizeof(std::uint16_t));
+        std::vector<std::uint16_t>().swap(output.half);
+    }
+
+    output.W = output.H = 0;
+}
+
+}
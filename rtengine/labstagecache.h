@@ -0,0 +1,78 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "noncopyable.h"
+
+namespace rtengine
+{
+
+class LabImage;
+
+/**
+  * Cache of the outputs of the stages applied to the Lab image of the preview and of the detail windows.
+  *
+  * The stages are applied in place, in the order of the Stage enum. When an event only changes the
+  * parameters of a stage (see M_SHARPENING, M_CBDL... in refreshmap.h), the processing restarts from
+  * the cached output of the previous stage instead of the Lab image coming out of rgbProc.
+  *
+  * With Settings::halfFloatStageCache, the outputs are kept as half floats, which halves the memory of the cache.
+  */
+class LabStageCache final :
+    public NonCopyable
+{
+public:
+    enum Stage {
+        COLOR,      // chromiLuminanceCurve, vibrance, EPDToneMap (M_LUMINANCE|M_COLOR)
+        DETAIL,     // impulse denoise, defringe, sharpening, microcontrast (M_SHARPENING)
+        CBDL,       // contrast by detail levels applied after the Lab conversion (M_CBDL)
+        WAVELET,    // ip_wavelet (M_WAVELET)
+        CIECAM,     // ciecam_02 (M_CIECAM)
+        NUM_STAGES
+    };
+
+    LabStageCache();
+    ~LabStageCache();
+
+    /** Returns the first stage which has to be computed for the todo flags, and copies its input to @dst:
+      * the cached output of the previous stage, or @src if there is none. */
+    Stage begin(int todo, LabImage* src, LabImage* dst);
+    /** Caches @img as the output of @stage. If @needed is false, i.e. none of the following stages has
+      * anything to do, the output isn't kept and the buffer is freed. */
+    void store(Stage stage, LabImage* img, bool needed);
+    void clear();
+
+private:
+    // output of a stage, either a LabImage or its L, a and b planes of W * H half floats
+    struct Output {
+        LabImage* image;
+        std::vector<std::uint16_t> half;
+        int W;
+        int H;
+    };
+
+    void release(Stage stage);
+
+    Output outputs[NUM_STAGES];
+    bool valid[NUM_STAGES];
+};
+
+}
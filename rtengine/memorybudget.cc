@@ -0,0 +1,139 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memorybudget.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "settings.h"
+
+namespace rtengine
+{
+
+extern const Settings* settings;
+
+namespace
+{
+
+thread_local MemoryBudget::PeakScope* currentScope = nullptr;
+
+}
+
+MemoryBudget& MemoryBudget::getInstance ()
+{
+    static MemoryBudget instance;
+    return instance;
+}
+
+MemoryBudget::MemoryBudget () :
+    limit (0),
+    usage (0),
+    peak (0)
+{
+}
+
+void MemoryBudget::setLimit (std::size_t bytes)
+{
+    limit = bytes;
+}
+
+std::size_t MemoryBudget::getLimit () const
+{
+    return limit;
+}
+
+void MemoryBudget::allocated (std::size_t bytes)
+{
+    const std::size_t newUsage = usage.fetch_add (bytes) + bytes;
+    std::size_t oldPeak = peak;
+
+    while (newUsage > oldPeak && !peak.compare_exchange_weak (oldPeak, newUsage)) {
+    }
+
+    if (currentScope) {
+        currentScope->usage += bytes;
+        currentScope->peak = std::max (currentScope->peak, currentScope->usage);
+    }
+}
+
+void MemoryBudget::released (std::size_t bytes)
+{
+    usage.fetch_sub (bytes);
+
+    if (currentScope) {
+        currentScope->usage -= bytes;
+    }
+}
+
+std::size_t MemoryBudget::getUsage () const
+{
+    return usage;
+}
+
+std::size_t MemoryBudget::getPeak () const
+{
+    return peak;
+}
+
+std::size_t MemoryBudget::getAvailable () const
+{
+    const std::size_t currentLimit = limit;
+
+    if (!currentLimit) {
+        return SIZE_MAX;
+    }
+
+    const std::size_t currentUsage = usage;
+    return currentUsage < currentLimit ? currentLimit - currentUsage : 0;
+}
+
+bool MemoryBudget::fits (std::size_t bytes) const
+{
+    return bytes <= getAvailable ();
+}
+
+MemoryBudget::PeakScope::PeakScope () :
+    previous (currentScope),
+    usage (0),
+    peak (0)
+{
+    currentScope = this;
+}
+
+MemoryBudget::PeakScope::~PeakScope ()
+{
+    currentScope = previous;
+}
+
+void MemoryBudget::PeakScope::report (const char* stage)
+{
+    if (settings && settings->verbose) {
+        const std::size_t currentLimit = getInstance().getLimit();
+        const std::size_t jobPeak = peak > 0 ? peak : 0;
+
+        if (currentLimit) {
+            printf ("Memory peak during %s: %zu MB (budget: %zu MB)\n", stage, jobPeak >> 20, currentLimit >> 20);
+        } else {
+            printf ("Memory peak during %s: %zu MB\n", stage, jobPeak >> 20);
+        }
+    }
+
+    peak = usage;
+}
+
+}
@@ -0,0 +1,87 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.h"
+
+namespace rtengine
+{
+
+/**
+  * Engine wide accounting of the memory held by the image buffers.
+  *
+  * PlanarRGBData, LabImage and array2D report their allocations here. The budget is not enforced on
+  * allocation: kernels with a memory/speed trade-off (e.g. the tile size of the denoise) query
+  * getAvailable() before they start and size their buffers accordingly. A limit of 0 means no limit.
+  */
+class MemoryBudget final :
+    public NonCopyable
+{
+public:
+    static MemoryBudget& getInstance ();
+
+    void setLimit (std::size_t bytes);
+    std::size_t getLimit () const;
+
+    void allocated (std::size_t bytes);
+    void released (std::size_t bytes);
+
+    std::size_t getUsage () const;
+    std::size_t getPeak () const;
+    /// Bytes which can still be allocated within the budget, SIZE_MAX if there is no limit
+    std::size_t getAvailable () const;
+    bool fits (std::size_t bytes) const;
+
+    /**
+      * Measures the peak of the buffers allocated by the thread running a processing job.
+      *
+      * The engine wide usage mixes the jobs running concurrently, hence each job accounts its own allocations
+      * in a scope living on its stack. Only the allocations and releases of the creating thread are counted:
+      * the buffers allocated inside parallel regions by the OpenMP workers only show up in the engine wide usage.
+      */
+    class PeakScope final :
+        public NonCopyable
+    {
+    public:
+        PeakScope ();
+        ~PeakScope ();
+
+        /// Prints the peak of the job since the previous report in verbose mode, and starts a new measurement
+        void report (const char* stage);
+
+    private:
+        friend class MemoryBudget;
+
+        PeakScope* const previous;
+        std::ptrdiff_t usage; // may become negative when buffers allocated before the scope are released
+        std::ptrdiff_t peak;
+    };
+
+private:
+    MemoryBudget ();
+
+    std::atomic<std::size_t> limit;
+    std::atomic<std::size_t> usage;
+    std::atomic<std::size_t> peak;
+};
+
+}
@@ -17,6 +17,7 @@
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "myfile.h"
+#include <atomic>
 #include <cstdarg>
 #include <glibmm.h>
 
@@ -61,6 +62,42 @@ int munmap(void *start, size_t length)
 #endif // WIN32
 #endif // MYFILE_MMAP
 
+namespace
+{
+
+// bytes served straight from a file mapping instead of being copied to the heap
+std::atomic<unsigned long long> mappedBytes(0);
+// bytes which had to be copied into a heap buffer
+std::atomic<unsigned long long> copiedBytes(0);
+
+IMFILE* heap_fopen (const char* fname)
+{
+
+    FILE* f = g_fopen (fname, "rb");
+
+    if (!f) {
+        return nullptr;
+    }
+
+    IMFILE* mf = new IMFILE;
+    memset(mf, 0, sizeof(*mf));
+    mf->fd = -1;
+    fseek (f, 0, SEEK_END);
+    mf->size = ftell (f);
+    mf->data = new char [mf->size];
+    fseek (f, 0, SEEK_SET);
+    fread (mf->data, 1, mf->size, f);
+    fclose (f);
+    mf->pos = 0;
+    mf->eof = false;
+
+    copiedBytes += mf->size;
+
+    return mf;
+}
+
+}
+
 #ifdef MYFILE_MMAP
 
 IMFILE* fopen (const char* fname)
@@ -96,14 +133,21 @@ IMFILE* fopen (const char* fname)
         return nullptr;
     }
 
-    void* data = mmap(nullptr, stat_buffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    void* data = stat_buffer.st_size > 0 ? mmap(nullptr, stat_buffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
 
     if ( data == MAP_FAILED ) {
-        printf("no mmap\n");
+        // some file systems (and empty files) can't be mapped, read the file into a heap buffer instead
         close(fd);
-        return nullptr;
+        return heap_fopen(fname);
     }
 
+#ifndef WIN32
+    // dcraw parses the headers and then decodes the raw data mostly front to back,
+    // so let the kernel start reading ahead right away
+    posix_madvise(data, stat_buffer.st_size, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(data, stat_buffer.st_size, POSIX_MADV_WILLNEED);
+#endif
+
     IMFILE* mf = new IMFILE;
 
     memset(mf, 0, sizeof(*mf));
@@ -113,6 +157,8 @@ IMFILE* fopen (const char* fname)
     mf->data = (char*)data;
     mf->eof = false;
 
+    mappedBytes += mf->size;
+
     return mf;
 }
 
@@ -124,48 +170,12 @@ IMFILE* gfopen (const char* fname)
 
 IMFILE* fopen (const char* fname)
 {
-
-    FILE* f = g_fopen (fname, "rb");
-
-    if (!f) {
-        return NULL;
-    }
-
-    IMFILE* mf = new IMFILE;
-    memset(mf, 0, sizeof(*mf));
-    fseek (f, 0, SEEK_END);
-    mf->size = ftell (f);
-    mf->data = new char [mf->size];
-    fseek (f, 0, SEEK_SET);
-    fread (mf->data, 1, mf->size, f);
-    fclose (f);
-    mf->pos = 0;
-    mf->eof = false;
-
-    return mf;
+    return heap_fopen(fname);
 }
 
 IMFILE* gfopen (const char* fname)
 {
-
-    FILE* f = g_fopen (fname, "rb");
-
-    if (!f) {
-        return NULL;
-    }
-
-    IMFILE* mf = new IMFILE;
-    memset(mf, 0, sizeof(*mf));
-    fseek (f, 0, SEEK_END);
-    mf->size = ftell (f);
-    mf->data = new char [mf->size];
-    fseek (f, 0, SEEK_SET);
-    fread (mf->data, 1, mf->size, f);
-    fclose (f);
-    mf->pos = 0;
-    mf->eof = false;
-
-    return mf;
+    return heap_fopen(fname);
 }
 #endif //MYFILE_MMAP
 
@@ -180,6 +190,9 @@ IMFILE* fopen (unsigned* buf, int size)
     memcpy ((void*)mf->data, buf, size);
     mf->pos = 0;
     mf->eof = false;
+
+    copiedBytes += size;
+
     return mf;
 }
 
@@ -263,6 +276,12 @@ char* fgets (char* s, int n, IMFILE* f)
     return s;
 }
 
+void imfile_get_stats(unsigned long long &mapped, unsigned long long &copied)
+{
+    mapped = mappedBytes;
+    copied = copiedBytes;
+}
+
 void imfile_set_plistener(IMFILE *f, rtengine::ProgressListener *plistener, double progress_range)
 {
     f->plistener = plistener;
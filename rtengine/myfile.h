@@ -43,6 +43,12 @@ struct IMFILE {
 void imfile_set_plistener(IMFILE *f, rtengine::ProgressListener *plistener, double progress_range);
 void imfile_update_progress(IMFILE *f);
 
+/*
+  Total number of bytes served from a file mapping (i.e. not copied into a heap buffer)
+  and number of bytes copied into heap buffers since program start
+ */
+void imfile_get_stats(unsigned long long &mapped, unsigned long long &copied);
+
 IMFILE* fopen (const char* fname);
 IMFILE* gfopen (const char* fname);
 IMFILE* fopen (unsigned* buf, int size);
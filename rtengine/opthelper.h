@@ -72,4 +72,14 @@
     #if defined _OPENMP
         #define _RT_NESTED_OPENMP
     #endif
+    // CPU_DISPATCH (set by CMake): the MULTIVERSION functions are compiled for AVX-512, AVX2 and the target processor,
+    // and the dynamic loader binds the best version for the running CPU. The versions share the source: the SSE
+    // intrinsics get the VEX encoding and the plain loops are vectorized 8 or 16 floats wide by the compiler.
+    // Hand written 8 and 16 wide loops use vfloatwide.h, see getDispatchedSimdWidth() in cpudispatch.h.
+    // OpenMP regions of these functions are cloned along with them.
+    #ifdef CPU_DISPATCH
+        #define MULTIVERSION __attribute__ ((target_clones ("avx512f", "avx2", "default")))
+    #else
+        #define MULTIVERSION
+    #endif
 #endif
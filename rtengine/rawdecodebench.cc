@@ -0,0 +1,106 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures the raw decoding speed (e.g. of compressed X-Trans files) for an increasing number of threads.
+// Usage: rtbench-rawdecode <rawfile> [runs]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <glib/gstdio.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "rawimage.h"
+#include "settings.h"
+#include "mytime.h"
+
+namespace rtengine
+{
+extern const Settings* settings;
+}
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cout << "Usage: rtbench-rawdecode <rawfile> [runs]" << std::endl;
+        return 1;
+    }
+
+    const int runs = argc > 2 ? std::max (1, atoi (argv[2])) : 3;
+
+    rtengine::Settings s;
+    s.verbose = false;
+    rtengine::settings = &s;
+
+    GStatBuf st;
+
+    if (g_stat (argv[1], &st) != 0) {
+        std::cerr << "Can't stat " << argv[1] << std::endl;
+        return 1;
+    }
+
+    const double fileMB = st.st_size / (1024.0 * 1024.0);
+
+#ifdef _OPENMP
+    const int maxThreads = omp_get_num_procs();
+#else
+    const int maxThreads = 1;
+#endif
+
+    printf ("%s: %.1f MB, best of %d runs\n", argv[1], fileMB, runs);
+    printf ("threads        ms      MB/s    Mpix/s\n");
+
+    for (int threads = 1;; threads = std::min (threads * 2, maxThreads)) {
+#ifdef _OPENMP
+        omp_set_num_threads (threads);
+#endif
+        long bestUs = -1;
+        double mpix = 0.0;
+
+        for (int run = 0; run < runs; ++run) {
+            rtengine::RawImage ri (argv[1]);
+            MyTime t1, t2;
+            t1.set();
+            const int errCode = ri.loadRaw (true, 0, true);
+            t2.set();
+
+            if (errCode) {
+                std::cerr << "Can't decode " << argv[1] << " (error " << errCode << ")" << std::endl;
+                return 1;
+            }
+
+            const long us = t2.etime (t1);
+
+            if (bestUs < 0 || us < bestUs) {
+                bestUs = us;
+            }
+
+            mpix = ri.get_width() * ri.get_height() / 1e6;
+        }
+
+        const double seconds = std::max (bestUs, 1L) / 1e6;
+        printf ("%7d %9.1f %9.1f %9.1f\n", threads, bestUs / 1000.0, fileMB / seconds, mpix / seconds);
+
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+
+    return 0;
+}
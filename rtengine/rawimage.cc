@@ -664,6 +664,12 @@ int RawImage::loadRaw (bool loadData, unsigned int imageNum, bool closeFile, Pro
         }
     }
 
+    if (settings->verbose) {
+        unsigned long long mapped, copied;
+        imfile_get_stats(mapped, copied);
+        printf("raw file access: %llu bytes mapped (not copied), %llu bytes copied so far\n", mapped, copied);
+    }
+
     if ( closeFile ) {
         fclose(ifp);
         ifp = nullptr;
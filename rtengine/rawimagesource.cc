@@ -22,6 +22,7 @@
 #include "rtengine.h"
 #include "rawimagesource.h"
 #include "rawimagesource_i.h"
+#include "demosaiccache.h"
 #include "jaggedarray.h"
 #include "median.h"
 #include "rawimage.h"
@@ -47,6 +48,9 @@
 namespace
 {
 
+constexpr int regionBlockSize = 256; // granularity of the bookkeeping of the region demosaic, in sensor pixels
+constexpr int regionMargin = 32;     // AMaZE mirrors the data at the borders of its window, this much of it is thrown away
+
 void rotateLine (const float* const line, rtengine::PlanarPtr<float> &channel, const int tran, const int i, const int w, const int h)
 {
     switch(tran & TR_ROT) {
@@ -464,6 +468,8 @@ RawImageSource::RawImageSource ()
     , red(0, 0)
     , blue(0, 0)
     , rawDirty(true)
+    , regionBlocksW(0)
+    , regionBlocksH(0)
 {
     camProfile = nullptr;
     embProfile = nullptr;
@@ -731,6 +737,10 @@ void RawImageSource::getImage (const ColorTemp &ctemp, int tran, Imagefloat* ima
     gm /= area;
     bm /= area;
     bool doHr = (hrp.hrenabled && hrp.method != "Color");
+    // the last windows which fit in the image, on the grid of the other windows: after demosaicBinned each window
+    // covers exactly one block of constant values, the clamped ones must not straddle two blocks
+    const int lasty = sy1 + skip * std::max((maxy - skip - 1 - sy1) / skip, 0);
+    const int lastx = sx1 + skip * std::max((maxx - skip - 1 - sx1) / skip, 0);
 #ifdef _OPENMP
     #pragma omp parallel if(!d1x)       // omp disabled for D1x to avoid race conditions (see Issue 1088 http://code.google.com/p/rawtherapee/issues/detail?id=1088)
     {
@@ -748,12 +758,12 @@ void RawImageSource::getImage (const ColorTemp &ctemp, int tran, Imagefloat* ima
             int i = sy1 + skip * ix;
 
             if (i >= maxy - skip) {
-                i = maxy - skip - 1;    // avoid trouble
+                i = lasty;    // avoid trouble
             }
 
             if (ri->getSensorType() == ST_BAYER || ri->getSensorType() == ST_FUJI_XTRANS || ri->get_colors() == 1) {
                 for (int j = 0, jx = sx1; j < imwidth; j++, jx += skip) {
-                    jx = std::min(jx, maxx - skip - 1); // avoid trouble
+                    jx = std::min(jx, lastx); // avoid trouble
 
                     float rtot = 0.f, gtot = 0.f, btot = 0.f;
 
@@ -1787,6 +1797,14 @@ void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &le
         printf( "Flat Field Correction:%s\n", rif->get_filename().c_str());
     }
 
+    if (DemosaicCache::getInstance().isEnabled()) {
+        preprocessKey = DemosaicCache::getPreprocessKey(raw, lensProf, coarse);
+        preprocessKey += ';' + (rid ? rid->get_filename() : std::string());
+        preprocessKey += ';' + (hasFlatField ? rif->get_filename() : std::string());
+    } else {
+        preprocessKey.clear();
+    }
+
     if(numFrames == 4) {
         int bufferNumber = 0;
         for(unsigned int i=0; i<4; ++i) {
@@ -2016,6 +2034,7 @@ void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &le
         delete bitmapBads;
     }
 
+    setRegionState(std::string());
     rawDirty = true;
     return;
 }
@@ -2026,6 +2045,32 @@ void RawImageSource::demosaic(const RAWParams &raw)
     MyTime t1, t2;
     t1.set();
 
+    // the cheap methods are faster to recompute than to read back from disk
+    const bool cacheable = !preprocessKey.empty()
+                           && ((ri->getSensorType() == ST_BAYER
+                                && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::fast]
+                                && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::mono]
+                                && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::none])
+                               || (ri->getSensorType() == ST_FUJI_XTRANS
+                                   && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::fast]
+                                   && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::mono]
+                                   && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::none]));
+    const std::string cacheKey = cacheable ? DemosaicCache::getKey(fileName, currFrame, preprocessKey, raw) : std::string();
+
+    const std::string &method = ri->getSensorType() == ST_FUJI_XTRANS ? raw.xtranssensor.method : raw.bayersensor.method;
+
+    if (!cacheKey.empty() && DemosaicCache::getInstance().load(cacheKey, W, H, red, green, blue)) {
+        rgbSourceModified = false;
+        setRegionState(method);
+
+        if (settings->verbose) {
+            t2.set();
+            printf("Demosaicing read from cache - %d usec\n", t2.etime(t1));
+        }
+
+        return;
+    }
+
     if (ri->getSensorType() == ST_BAYER) {
         if ( raw.bayersensor.method == RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::hphd] ) {
             hphd_demosaic ();
@@ -2076,6 +2121,11 @@ void RawImageSource::demosaic(const RAWParams &raw)
 
 
     rgbSourceModified = false;
+    setRegionState(method);
+
+    if (!cacheKey.empty()) {
+        DemosaicCache::getInstance().store(cacheKey, W, H, red, green, blue);
+    }
 
 
     if( settings->verbose ) {
@@ -2088,6 +2138,127 @@ void RawImageSource::demosaic(const RAWParams &raw)
 }
 
 
+void RawImageSource::setRegionState(const std::string &method)
+{
+    // the full frame holds the output of method, an empty method marks the rgb data as invalid
+    regionMethod = method;
+    regionBlocksW = (W + regionBlockSize - 1) / regionBlockSize;
+    regionBlocksH = (H + regionBlockSize - 1) / regionBlockSize;
+    regionBlocks.assign(regionBlocksW * regionBlocksH, !method.empty());
+}
+
+bool RawImageSource::canDemosaicRegion(const RAWParams &raw) const
+{
+    // AMaZE is the only window capable method worth it, DCB and LMMSE work on the full frame.
+    // The rotated Fuji and the D1x sensors don't map a preview rectangle to a plain sensor rectangle
+    return ri && ri->getSensorType() == ST_BAYER && !fuji && !d1x
+           && raw.bayersensor.method == RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::amaze];
+}
+
+void RawImageSource::demosaicRegion(const RAWParams &raw, int tran, const PreviewProps &pp)
+{
+    if (!canDemosaicRegion(raw) || !red || !green || !blue) {
+        return;
+    }
+
+    MyMutex::MyLock lock(getImageMutex);
+
+    const std::string &method = raw.bayersensor.method;
+
+    if (regionMethod.empty()) {
+        return; // nothing demosaiced yet, the next full demosaic will do
+    }
+
+    if (method != regionMethod) {
+        // the frame holds the output of another method, e.g. the fast one used for the preview
+        regionBlocks.assign(regionBlocks.size(), false);
+        regionMethod = method;
+    }
+
+    tran = defTransform(tran);
+    int sx1, sy1, width, height, fw;
+    transformRect(pp, tran, sx1, sy1, width, height, fw);
+    const int sx2 = std::min(sx1 + width * pp.getSkip() + 2, W);
+    const int sy2 = std::min(sy1 + height * pp.getSkip() + 2, H);
+    sx1 = std::max(sx1 - 2, 0);
+    sy1 = std::max(sy1 - 2, 0);
+
+    // bounding box of the blocks still missing
+    int bx1 = regionBlocksW, by1 = regionBlocksH, bx2 = -1, by2 = -1;
+
+    for (int by = sy1 / regionBlockSize; by <= (sy2 - 1) / regionBlockSize; ++by) {
+        for (int bx = sx1 / regionBlockSize; bx <= (sx2 - 1) / regionBlockSize; ++bx) {
+            if (!regionBlocks[by * regionBlocksW + bx]) {
+                bx1 = std::min(bx1, bx);
+                by1 = std::min(by1, by);
+                bx2 = std::max(bx2, bx);
+                by2 = std::max(by2, by);
+            }
+        }
+    }
+
+    if (bx2 < 0) {
+        return;
+    }
+
+    MyTime t1, t2;
+    t1.set();
+
+    const int x1 = bx1 * regionBlockSize;
+    const int y1 = by1 * regionBlockSize;
+    const int x2 = std::min((bx2 + 1) * regionBlockSize, W);
+    const int y2 = std::min((by2 + 1) * regionBlockSize, H);
+    const int winx = std::max(x1 - regionMargin, 0);
+    const int winy = std::max(y1 - regionMargin, 0);
+    const int winw = std::min(x2 + regionMargin, W) - winx;
+    const int winh = std::min(y2 + regionMargin, H) - winy;
+
+    // the margin keeps its former content, which may be the output of an earlier region
+    array2D<float> savedRed(winw, winh), savedGreen(winw, winh), savedBlue(winw, winh);
+
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+
+    for (int i = 0; i < winh; ++i) {
+        memcpy(savedRed[i], red[winy + i] + winx, winw * sizeof(float));
+        memcpy(savedGreen[i], green[winy + i] + winx, winw * sizeof(float));
+        memcpy(savedBlue[i], blue[winy + i] + winx, winw * sizeof(float));
+    }
+
+    amaze_demosaic_RT(winx, winy, winw, winh, rawData, red, green, blue);
+
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+
+    for (int i = 0; i < winh; ++i) {
+        const int row = winy + i;
+        const bool inside = row >= y1 && row < y2;
+
+        for (int j = 0; j < winw; ++j) {
+            const int col = winx + j;
+
+            if (!inside || col < x1 || col >= x2) {
+                red[row][col] = savedRed[i][j];
+                green[row][col] = savedGreen[i][j];
+                blue[row][col] = savedBlue[i][j];
+            }
+        }
+    }
+
+    for (int by = by1; by <= by2; ++by) {
+        for (int bx = bx1; bx <= bx2; ++bx) {
+            regionBlocks[by * regionBlocksW + bx] = true;
+        }
+    }
+
+    if (settings->verbose) {
+        t2.set();
+        printf("Demosaicing region %d,%d %dx%d: %s - %d usec\n", x1, y1, x2 - x1, y2 - y1, method.c_str(), t2.etime(t1));
+    }
+}
+
 //void RawImageSource::retinexPrepareBuffers(ColorManagementParams cmp, RetinexParams retinexParams, multi_array2D<float, 3> &conversionBuffer, LUTu &lhist16RETI)
 void RawImageSource::retinexPrepareBuffers(ColorManagementParams cmp, const RetinexParams &retinexParams, multi_array2D<float, 4> &conversionBuffer, LUTu &lhist16RETI)
 {
@@ -2777,6 +2948,8 @@ void RawImageSource::flushRGB()
     if (blue) {
         blue(0, 0);
     }
+
+    setRegionState(std::string());
 }
 
 void RawImageSource::HLRecovery_Global(ToneCurveParams hrp)
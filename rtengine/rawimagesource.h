@@ -26,6 +26,7 @@
 #include "color.h"
 #include "iimage.h"
 #include <iostream>
+#include <vector>
 #define HR_SCALE 2
 
 namespace rtengine
@@ -91,6 +92,11 @@ protected:
     // the interpolated blue plane:
     array2D<float> blue;
     bool rawDirty;
+    std::string preprocessKey; // preprocessing part of the demosaic cache key, empty if the cache is disabled
+    // region demosaic: the blocks flagged in regionBlocks hold the output of regionMethod, the others the one of the last full demosaic
+    std::string regionMethod;
+    std::vector<bool> regionBlocks;
+    int regionBlocksW, regionBlocksH;
     float psRedBrightness[4];
     float psGreenBrightness[4];
     float psBlueBrightness[4];
@@ -103,6 +109,7 @@ protected:
     void hlRecovery          (const std::string &method, float* red, float* green, float* blue, int width, float* hlmax);
     void transformRect       (const PreviewProps &pp, int tran, int &sx1, int &sy1, int &width, int &height, int &fw);
     void transformPosition   (int x, int y, int tran, int& tx, int& ty);
+    void setRegionState      (const std::string &method);
 
     unsigned FC(int row, int col)
     {
@@ -119,6 +126,9 @@ public:
     int         load        (const Glib::ustring &fname, int imageNum = 0, bool batch = false);
     void        preprocess  (const RAWParams &raw, const LensProfParams &lensProf, const CoarseTransformParams& coarse, bool prepareDenoise = true);
     void        demosaic    (const RAWParams &raw);
+    bool        canDemosaicRegion (const RAWParams &raw) const;
+    void        demosaicRegion    (const RAWParams &raw, int tran, const PreviewProps &pp);
+    bool        demosaicBinned    (const RAWParams &raw, int tran, const PreviewProps &pp);
     void        retinex       (ColorManagementParams cmp, const RetinexParams &deh, ToneCurveParams Tc, LUTf & cdcurve, LUTf & mapcurve, const RetinextransmissionCurve & dehatransmissionCurve, const RetinexgaintransmissionCurve & dehagaintransmissionCurve, multi_array2D<float, 4> &conversionBuffer, bool dehacontlutili, bool mapcontlutili, bool useHsl, float &minCD, float &maxCD, float &mini, float &maxi, float &Tmean, float &Tsigma, float &Tmin, float &Tmax, LUTu &histLRETI);
     void        retinexPrepareCurves       (const RetinexParams &retinexParams, LUTf &cdcurve, LUTf &mapcurve, RetinextransmissionCurve &retinextransmissionCurve, RetinexgaintransmissionCurve &retinexgaintransmissionCurve, bool &retinexcontlutili, bool &mapcontlutili, bool &useHsl, LUTu & lhist16RETI, LUTu & histLRETI);
     void        retinexPrepareBuffers      (ColorManagementParams cmp, const RetinexParams &retinexParams, multi_array2D<float, 4> &conversionBuffer, LUTu &lhist16RETI);
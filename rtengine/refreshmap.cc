@@ -184,11 +184,11 @@ int refreshmap[rtengine::NUMOFEVENTS] = {
     RGBCURVE,         // EvVibranceAvoidColorShift
     RGBCURVE,         // EvVibrancePastSatTog
     RGBCURVE,         // EvVibrancePastSatThreshold
-    SHARPENING,       // EvEPDStrength
-    SHARPENING,       // EvEPDEdgeStopping
-    SHARPENING,       // EvEPDScale
-    SHARPENING,       // EvEPDReweightingIterates
-    SHARPENING,       // EvEPDEnabled
+    TONEMAPPING,      // EvEPDStrength
+    TONEMAPPING,      // EvEPDEdgeStopping
+    TONEMAPPING,      // EvEPDScale
+    TONEMAPPING,      // EvEPDReweightingIterates
+    TONEMAPPING,      // EvEPDEnabled
     RGBCURVE,         // EvRGBrCurve
     RGBCURVE,         // EvRGBgCurve
     RGBCURVE,         // EvRGBbCurve
@@ -201,38 +201,38 @@ int refreshmap[rtengine::NUMOFEVENTS] = {
     LUMINANCECURVE,   // EvLLCredsk
     ALLNORAW,         // EvDPDNLdetail
     ALLNORAW,         // EvCATEnabled
-    LUMINANCECURVE,   // EvCATDegree
-    LUMINANCECURVE,   // EvCATMethodsur
-    LUMINANCECURVE,   // EvCATAdapscen
-    LUMINANCECURVE,   // EvCATAdapLum
-    LUMINANCECURVE,   // EvCATMethodWB
-    LUMINANCECURVE,   // EvCATJLight
-    LUMINANCECURVE,   // EvCATChroma
-    LUMINANCECURVE,   // EvCATAutoDegree
-    LUMINANCECURVE,   // EvCATContrast
-    LUMINANCECURVE,   // EvCATSurr
+    CIECAM,           // EvCATDegree
+    CIECAM,           // EvCATMethodsur
+    CIECAM,           // EvCATAdapscen
+    CIECAM,           // EvCATAdapLum
+    CIECAM,           // EvCATMethodWB
+    CIECAM,           // EvCATJLight
+    CIECAM,           // EvCATChroma
+    CIECAM,           // EvCATAutoDegree
+    CIECAM,           // EvCATContrast
+    CIECAM,           // EvCATSurr
     LUMINANCECURVE,   // EvCATgamut
-    LUMINANCECURVE,   // EvCATmethodalg
-    LUMINANCECURVE,   // EvCATRstpro
-    LUMINANCECURVE,   // EvCATQbright
-    LUMINANCECURVE,   // EvCATQContrast
-    LUMINANCECURVE,   // EvCATSChroma
-    LUMINANCECURVE,   // EvCATMchroma
-    LUMINANCECURVE,   // EvCAThue
-    LUMINANCECURVE,   // EvCATcurve1
-    LUMINANCECURVE,   // EvCATcurve2
-    LUMINANCECURVE,   // EvCATcurvemode1
-    LUMINANCECURVE,   // EvCATcurvemode2
-    LUMINANCECURVE,   // EvCATcurve3
-    LUMINANCECURVE,   // EvCATcurvemode3
-    LUMINANCECURVE,   // EvCATdatacie
+    CIECAM,           // EvCATmethodalg
+    CIECAM,           // EvCATRstpro
+    CIECAM,           // EvCATQbright
+    CIECAM,           // EvCATQContrast
+    CIECAM,           // EvCATSChroma
+    CIECAM,           // EvCATMchroma
+    CIECAM,           // EvCAThue
+    CIECAM,           // EvCATcurve1
+    CIECAM,           // EvCATcurve2
+    CIECAM,           // EvCATcurvemode1
+    CIECAM,           // EvCATcurvemode2
+    CIECAM,           // EvCATcurve3
+    CIECAM,           // EvCATcurvemode3
+    CIECAM,           // EvCATdatacie
     LUMINANCECURVE,   // EvCATtonecie
     ALLNORAW,         // EvDPDNbluechro
     ALLNORAW,         // EvDPDNperform
     ALLNORAW,         // EvDPDNmet
     DEMOSAIC,         // EvDemosaicLMMSEIter
-    LUMINANCECURVE,   // EvCATbadpix
-    LUMINANCECURVE,   // EvCATAutoadap
+    CIECAM,           // EvCATbadpix
+    CIECAM,           // EvCATAutoadap
     DEFRINGE,         // EvPFCurve
     ALLNORAW,         // EvWBequal
     ALLNORAW,         // EvWBequalbo
@@ -330,73 +330,73 @@ int refreshmap[rtengine::NUMOFEVENTS] = {
     ALLNORAW,         // EvDPDNLmet
     ALLNORAW,         // EvDPDNCmet
     ALLNORAW,         // EvDPDNC2met
-    DIRPYREQUALIZER,  // EvWavelet
-    DIRPYREQUALIZER,  // EvEnabled
-    DIRPYREQUALIZER,  // EvWavLmethod
-    DIRPYREQUALIZER,  // EvWavCLmethod
-    DIRPYREQUALIZER,  // EvWavDirmethod
-    DIRPYREQUALIZER,  // EvWavtiles
-    DIRPYREQUALIZER,  // EvWavsky
-    DIRPYREQUALIZER,  // EvWavthres
-    DIRPYREQUALIZER,  // EvWavthr
-    DIRPYREQUALIZER,  // EvWavchroma
-    DIRPYREQUALIZER,  // EvWavmedian
-    DIRPYREQUALIZER,  // EvWavunif
-    DIRPYREQUALIZER,  // EvWavSkin
-    DIRPYREQUALIZER,  // EvWavHueSkin
-    DIRPYREQUALIZER,  // EvWavThreshold
-    DIRPYREQUALIZER,  // EvWavlhl
-    DIRPYREQUALIZER,  // EvWavbhl
-    DIRPYREQUALIZER,  // EvWavThresHold2
-    DIRPYREQUALIZER,  // EvWavavoid
-    DIRPYREQUALIZER,  // EvWavCCCurve
-    DIRPYREQUALIZER,  // EvWavpast
-    DIRPYREQUALIZER,  // EvWavsat
-    DIRPYREQUALIZER,  // EvWavCHmet
-    DIRPYREQUALIZER,  // EvWavHSmet
-    DIRPYREQUALIZER,  // EvWavchro
-    DIRPYREQUALIZER,  // EvWavColor
-    DIRPYREQUALIZER,  // EvWavOpac
-    DIRPYREQUALIZER,  // EvWavsup
-    DIRPYREQUALIZER,  // EvWavTilesmet
-    DIRPYREQUALIZER,  // EvWavrescon
-    DIRPYREQUALIZER,  // EvWavreschro
-    DIRPYREQUALIZER,  // EvWavresconH
-    DIRPYREQUALIZER,  // EvWavthrH
-    DIRPYREQUALIZER,  // EvWavHueskin2
-    DIRPYREQUALIZER,  // EvWavedgrad
-    DIRPYREQUALIZER,  // EvWavedgval
-    DIRPYREQUALIZER,  // EvWavStrngth
-    DIRPYREQUALIZER,  // EvWavdaubcoeffmet
-    DIRPYREQUALIZER,  // EvWavedgreinf
-    DIRPYREQUALIZER,  // EvWaveletch
-    DIRPYREQUALIZER,  // EvWavCHSLmet
-    DIRPYREQUALIZER,  // EvWavedgcont
-    DIRPYREQUALIZER,  // EvWavEDmet
-    DIRPYREQUALIZER,  // EvWavlev0nois
-    DIRPYREQUALIZER,  // EvWavlev1nois
-    DIRPYREQUALIZER,  // EvWavlev2nois
-    DIRPYREQUALIZER,  // EvWavmedianlev
-    DIRPYREQUALIZER,  // EvWavHHCurve
-    DIRPYREQUALIZER,  // EvWavBackmet
-    DIRPYREQUALIZER,  // EvWavedgedetect
-    DIRPYREQUALIZER,  // EvWavlipst
-    DIRPYREQUALIZER,  // EvWavedgedetectthr
-    DIRPYREQUALIZER,  // EvWavedgedetectthr2
-    DIRPYREQUALIZER,  // EvWavlinkedg
-    DIRPYREQUALIZER,  // EvWavCHCurve
+    WAVELET,          // EvWavelet
+    WAVELET,          // EvEnabled
+    WAVELET,          // EvWavLmethod
+    WAVELET,          // EvWavCLmethod
+    WAVELET,          // EvWavDirmethod
+    WAVELET,          // EvWavtiles
+    WAVELET,          // EvWavsky
+    WAVELET,          // EvWavthres
+    WAVELET,          // EvWavthr
+    WAVELET,          // EvWavchroma
+    WAVELET,          // EvWavmedian
+    WAVELET,          // EvWavunif
+    WAVELET,          // EvWavSkin
+    WAVELET,          // EvWavHueSkin
+    WAVELET,          // EvWavThreshold
+    WAVELET,          // EvWavlhl
+    WAVELET,          // EvWavbhl
+    WAVELET,          // EvWavThresHold2
+    WAVELET,          // EvWavavoid
+    WAVELET,          // EvWavCCCurve
+    WAVELET,          // EvWavpast
+    WAVELET,          // EvWavsat
+    WAVELET,          // EvWavCHmet
+    WAVELET,          // EvWavHSmet
+    WAVELET,          // EvWavchro
+    WAVELET,          // EvWavColor
+    WAVELET,          // EvWavOpac
+    WAVELET,          // EvWavsup
+    WAVELET,          // EvWavTilesmet
+    WAVELET,          // EvWavrescon
+    WAVELET,          // EvWavreschro
+    WAVELET,          // EvWavresconH
+    WAVELET,          // EvWavthrH
+    WAVELET,          // EvWavHueskin2
+    WAVELET,          // EvWavedgrad
+    WAVELET,          // EvWavedgval
+    WAVELET,          // EvWavStrngth
+    WAVELET,          // EvWavdaubcoeffmet
+    WAVELET,          // EvWavedgreinf
+    WAVELET,          // EvWaveletch
+    WAVELET,          // EvWavCHSLmet
+    WAVELET,          // EvWavedgcont
+    WAVELET,          // EvWavEDmet
+    WAVELET,          // EvWavlev0nois
+    WAVELET,          // EvWavlev1nois
+    WAVELET,          // EvWavlev2nois
+    WAVELET,          // EvWavmedianlev
+    WAVELET,          // EvWavHHCurve
+    WAVELET,          // EvWavBackmet
+    WAVELET,          // EvWavedgedetect
+    WAVELET,          // EvWavlipst
+    WAVELET,          // EvWavedgedetectthr
+    WAVELET,          // EvWavedgedetectthr2
+    WAVELET,          // EvWavlinkedg
+    WAVELET,          // EvWavCHCurve
     DARKFRAME,        // EvPreProcessHotDeadThresh
-    SHARPENING,       // EvEPDgamma
-    DIRPYREQUALIZER,  // EvWavtmr
-    DIRPYREQUALIZER,  // EvWavTMmet
-    DIRPYREQUALIZER,  // EvWavtmrs
-    DIRPYREQUALIZER,  // EvWavbalance
-    DIRPYREQUALIZER,  // EvWaviter
-    DIRPYREQUALIZER,  // EvWavgamma
-    DIRPYREQUALIZER,  // EvWavCLCurve
-    DIRPYREQUALIZER,  // EvWavopacity
-    DIRPYREQUALIZER,  // EvWavBAmet
-    DIRPYREQUALIZER,  // EvWavopacityWL
+    TONEMAPPING,      // EvEPDgamma
+    WAVELET,          // EvWavtmr
+    WAVELET,          // EvWavTMmet
+    WAVELET,          // EvWavtmrs
+    WAVELET,          // EvWavbalance
+    WAVELET,          // EvWaviter
+    WAVELET,          // EvWavgamma
+    WAVELET,          // EvWavCLCurve
+    WAVELET,          // EvWavopacity
+    WAVELET,          // EvWavBAmet
+    WAVELET,          // EvWavopacityWL
     RESIZE,           // EvPrShrEnabled
     RESIZE,           // EvPrShrRadius
     RESIZE,           // EvPrShrAmount
@@ -411,28 +411,28 @@ int refreshmap[rtengine::NUMOFEVENTS] = {
     RESIZE,           // EvPrShrDAmount=381,
     RESIZE,           // EvPrShrDDamping=382,
     RESIZE,           // EvPrShrDIterations=383,
-    DIRPYREQUALIZER,  // EvWavcbenab
-    DIRPYREQUALIZER,  // EvWavgreenhigh
-    DIRPYREQUALIZER,  // EvWavbluehigh
-    DIRPYREQUALIZER,  // EvWavgreenmed
-    DIRPYREQUALIZER,  // EvWavbluemed
-    DIRPYREQUALIZER,  // EvWavgreenlow
-    DIRPYREQUALIZER,  // EvWavbluelow
-    DIRPYREQUALIZER,  // EvWavNeutral
+    WAVELET,          // EvWavcbenab
+    WAVELET,          // EvWavgreenhigh
+    WAVELET,          // EvWavbluehigh
+    WAVELET,          // EvWavgreenmed
+    WAVELET,          // EvWavbluemed
+    WAVELET,          // EvWavgreenlow
+    WAVELET,          // EvWavbluelow
+    WAVELET,          // EvWavNeutral
     RGBCURVE,         // EvDCPApplyLookTable,
     RGBCURVE,         // EvDCPApplyBaselineExposureOffset,
     ALLNORAW,         // EvDCPApplyHueSatMap
-    DIRPYREQUALIZER,  // EvWavenacont
-    DIRPYREQUALIZER,  // EvWavenachrom
-    DIRPYREQUALIZER,  // EvWavenaedge
-    DIRPYREQUALIZER,  // EvWavenares
-    DIRPYREQUALIZER,  // EvWavenafin
-    DIRPYREQUALIZER,  // EvWavenatoning
-    DIRPYREQUALIZER,  // EvWavenanoise
-    DIRPYREQUALIZER,  // EvWavedgesensi
-    DIRPYREQUALIZER,  // EvWavedgeampli
-    DIRPYREQUALIZER,  // EvWavlev3nois
-    DIRPYREQUALIZER,  // EvWavNPmet
+    WAVELET,          // EvWavenacont
+    WAVELET,          // EvWavenachrom
+    WAVELET,          // EvWavenaedge
+    WAVELET,          // EvWavenares
+    WAVELET,          // EvWavenafin
+    WAVELET,          // EvWavenatoning
+    WAVELET,          // EvWavenanoise
+    WAVELET,          // EvWavedgesensi
+    WAVELET,          // EvWavedgeampli
+    WAVELET,          // EvWavlev3nois
+    WAVELET,          // EvWavNPmet
     DEMOSAIC,         // EvretinexMethod
     RETINEX,          // EvLneigh
     RETINEX,          // EvLgain
@@ -502,15 +502,15 @@ int refreshmap[rtengine::NUMOFEVENTS] = {
     DEMOSAIC,         // EvPixelShiftLmmse
     DEMOSAIC,         // EvPixelShiftEqualBright
     DEMOSAIC,          // EvPixelShiftEqualBrightChannel
-    LUMINANCECURVE,   // EvCATtempout
-    LUMINANCECURVE,   // EvCATgreenout
-    LUMINANCECURVE,   // EvCATybout
-    LUMINANCECURVE,   // EvCATDegreeout
-    LUMINANCECURVE,   // EvCATAutoDegreeout
-    LUMINANCECURVE,   // EvCATtempsc
-    LUMINANCECURVE,   // EvCATgreensc
-    LUMINANCECURVE,   // EvCATybscen
-    LUMINANCECURVE,   // EvCATAutoyb
+    CIECAM,           // EvCATtempout
+    CIECAM,           // EvCATgreenout
+    CIECAM,           // EvCATybout
+    CIECAM,           // EvCATDegreeout
+    CIECAM,           // EvCATAutoDegreeout
+    CIECAM,           // EvCATtempsc
+    CIECAM,           // EvCATgreensc
+    CIECAM,           // EvCATybscen
+    CIECAM,           // EvCATAutoyb
     DARKFRAME,        // EvLensCorrMode
     DARKFRAME,        // EvLensCorrLensfunCamera
     DARKFRAME         // EvLensCorrLensfunLens
@@ -44,23 +44,34 @@
 #define M_LUMINANCE   (1<<1)
 #define M_COLOR       (1<<0)
 
+// Stages applied to the Lab image after M_LUMINANCE|M_COLOR, in this order. The output of each stage is cached
+// (see LabStageCache), so an event only recomputes its own stage and the following ones
+#define M_SHARPENING  (1<<17)
+#define M_CBDL        (1<<18)
+#define M_WAVELET     (1<<19)
+#define M_CIECAM      (1<<20)
+#define M_LABSTAGES   (M_LUMINANCE|M_COLOR|M_SHARPENING|M_CBDL|M_WAVELET|M_CIECAM)
+
 // Bitfield of functions to do to the preview image when an event occurs
 // Use those or create new ones for your new events
-#define FIRST            (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR|M_MONITOR)  // without HIGHQUAL
-#define ALL              (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)  // without HIGHQUAL
-#define DARKFRAME        (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define FLATFIELD        (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define DEMOSAIC                   (M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define ALLNORAW                         (M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define TRANSFORM                                            (M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define AUTOEXP                                                                    (M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define RGBCURVE                                                                             (M_RGBCURVE|M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define LUMINANCECURVE                                                                                  (M_LUMACURVE|M_LUMINANCE|M_COLOR)
-#define SHARPENING                                                                                                  (M_LUMINANCE|M_COLOR)
-#define IMPULSEDENOISE                                                                                              (M_LUMINANCE|M_COLOR)
-#define DEFRINGE                                                                                                    (M_LUMINANCE|M_COLOR)
-#define DIRPYRDENOISE                                                                                               (M_LUMINANCE|M_COLOR)
-#define DIRPYREQUALIZER                                                                                             (M_LUMINANCE|M_COLOR)
+#define FIRST            (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES|M_MONITOR)  // without HIGHQUAL
+#define ALL              (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)  // without HIGHQUAL
+#define DARKFRAME        (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define FLATFIELD        (M_PREPROC|M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define DEMOSAIC                   (M_RAW|M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define ALLNORAW                         (M_INIT|M_LINDENOISE|M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define TRANSFORM                                            (M_TRANSFORM|M_BLURMAP|M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define AUTOEXP                                                                    (M_AUTOEXP|M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define RGBCURVE                                                                             (M_RGBCURVE|M_LUMACURVE|M_LABSTAGES)
+#define LUMINANCECURVE                                                                                  (M_LUMACURVE|M_LABSTAGES)
+#define TONEMAPPING                                                                                                  M_LABSTAGES
+#define SHARPENING                                                                       (M_SHARPENING|M_CBDL|M_WAVELET|M_CIECAM)
+#define IMPULSEDENOISE                                                                   (M_SHARPENING|M_CBDL|M_WAVELET|M_CIECAM)
+#define DEFRINGE                                                                         (M_SHARPENING|M_CBDL|M_WAVELET|M_CIECAM)
+#define DIRPYRDENOISE                                                                                                M_LABSTAGES
+#define DIRPYREQUALIZER                                                                               (M_CBDL|M_WAVELET|M_CIECAM)
+#define WAVELET                                                                                              (M_WAVELET|M_CIECAM)
+#define CIECAM                                                                                                          M_CIECAM
 #define GAMMA             M_MONITOR
 #define CROP              M_CROP
 #define RESIZE            M_VOID
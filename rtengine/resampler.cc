@@ -0,0 +1,291 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "array2D.h"
+#include "opthelper.h"
+#include "rt_math.h"
+#include "sleef.c"
+
+namespace
+{
+
+inline float Lanc (float x, float a)
+{
+    if (x * x < 1e-6f) {
+        return 1.0f;
+    } else if (x * x > a * a) {
+        return 0.0f;
+    } else {
+        x = static_cast<float> (rtengine::RT_PI) * x;
+        return a * xsinf (x) * xsinf (x / a) / (x * x);
+    }
+}
+
+inline void storeSample (float value, float &dst)
+{
+    dst = value;
+}
+
+inline void storeSample (float value, unsigned short &dst)
+{
+    dst = rtengine::CLIP (static_cast<int> (value));
+}
+
+}
+
+namespace rtengine
+{
+
+ResampleWeightCache& ResampleWeightCache::getInstance ()
+{
+    static ResampleWeightCache instance;
+    return instance;
+}
+
+std::shared_ptr<const ResampleWeights> ResampleWeightCache::getLanczos (int srcLen, int dstLen, float scale, float a)
+{
+    {
+        MyMutex::MyLock lock (mutex);
+
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->srcLen == srcLen && it->dstLen == dstLen && it->scale == scale && it->a == a) {
+                entries.splice (entries.begin(), entries, it);
+                return it->weights;
+            }
+        }
+    }
+
+    // computed unlocked, two threads asking for the same table at once both compute it
+    std::shared_ptr<const ResampleWeights> weights = computeLanczos (srcLen, dstLen, scale, a);
+
+    MyMutex::MyLock lock (mutex);
+    entries.push_front ({srcLen, dstLen, scale, a, weights});
+
+    if (entries.size() > maxEntries) {
+        entries.pop_back();
+    }
+
+    return weights;
+}
+
+std::shared_ptr<const ResampleWeights> ResampleWeightCache::computeLanczos (int srcLen, int dstLen, float scale, float a)
+{
+    constexpr int lanes = ResampleWeights::lanes;
+
+    const float delta = 1.0f / scale;
+    const float sc = min (scale, 1.0f);
+
+    std::shared_ptr<ResampleWeights> result = std::make_shared<ResampleWeights>();
+    result->srcLen = srcLen;
+    result->dstLen = dstLen;
+    result->support = static_cast<int> (2.0f * a / sc) + 1;
+
+    const int paddedLen = (dstLen + lanes - 1) / lanes * lanes;
+    result->start.assign (paddedLen, 0);
+    result->weights.assign (paddedLen * result->support, 0.f);
+
+    for (int j = 0; j < dstLen; j++) {
+        // x coord of the center of pixel on src image
+        const float x0 = (static_cast<float> (j) + 0.5f) * delta - 0.5f;
+
+        const int j0 = max (0, static_cast<int> (floorf (x0 - a / sc)) + 1);
+        const int j1 = min (srcLen, static_cast<int> (floorf (x0 + a / sc)) + 1);
+        float* const w = &result->weights[(j / lanes) * result->support * lanes + j % lanes];
+
+        // sum of weights used for normalization
+        float ws = 0.0f;
+
+        for (int jj = j0; jj < j1; jj++) {
+            const float wk = Lanc (sc * (x0 - static_cast<float> (jj)), a);
+            w[(jj - j0) * lanes] = wk;
+            ws += wk;
+        }
+
+        for (int k = 0; k < j1 - j0; k++) {
+            w[k * lanes] /= ws;
+        }
+
+        result->start[j] = j0;
+    }
+
+    return result;
+}
+
+template<typename S, typename D>
+void Resampler::lanczos (S** const src[], int srcW, int srcH, D** const dst[], int dstW, int dstH, int planes, float scale, bool boxPrescale)
+{
+    // at least a 2x reduction is left to the Lanczos filter, which keeps its anti-aliasing
+    const int factor = boxPrescale && scale <= 0.25f ? static_cast<int> (0.5f / scale) : 1;
+
+    if (factor < 2) {
+        lanczosPass (src, srcW, srcH, dst, dstW, dstH, planes, scale);
+        return;
+    }
+
+    const int boxW = (srcW + factor - 1) / factor;
+    const int boxH = (srcH + factor - 1) / factor;
+    array2D<float> box[3];
+    float** boxPlanes[3];
+
+    for (int p = 0; p < planes; p++) {
+        box[p] (boxW, boxH);
+        boxPlanes[p] = box[p];
+    }
+
+    boxDownscale (src, srcW, srcH, boxPlanes, planes, factor);
+    lanczosPass (boxPlanes, boxW, boxH, dst, dstW, dstH, planes, scale * factor);
+}
+
+template<typename S>
+MULTIVERSION void Resampler::boxDownscale (S** const src[], int srcW, int srcH, float** const dst[], int planes, int factor)
+{
+    const int dstW = (srcW + factor - 1) / factor;
+    const int dstH = (srcH + factor - 1) / factor;
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        // sum of the rows of a block
+        std::vector<float> column (srcW);
+
+#ifdef _OPENMP
+        #pragma omp for
+#endif
+
+        for (int i = 0; i < dstH; i++) {
+            const int y0 = i * factor;
+            const int y1 = min (y0 + factor, srcH);
+
+            for (int p = 0; p < planes; p++) {
+                const S* const first = src[p][y0];
+
+                for (int j = 0; j < srcW; j++) {
+                    column[j] = first[j];
+                }
+
+                for (int y = y0 + 1; y < y1; y++) {
+                    const S* const row = src[p][y];
+
+                    for (int j = 0; j < srcW; j++) {
+                        column[j] += row[j];
+                    }
+                }
+
+                float* const out = dst[p][i];
+
+                for (int j = 0; j < dstW; j++) {
+                    const int x0 = j * factor;
+                    const int x1 = min (x0 + factor, srcW);
+                    float sum = 0.f;
+
+                    for (int x = x0; x < x1; x++) {
+                        sum += column[x];
+                    }
+
+                    out[j] = sum / ((x1 - x0) * (y1 - y0));
+                }
+            }
+        }
+    }
+}
+
+template<typename S, typename D>
+MULTIVERSION void Resampler::lanczosPass (S** const src[], int srcW, int srcH, D** const dst[], int dstW, int dstH, int planes, float scale)
+{
+    constexpr int lanes = ResampleWeights::lanes;
+    const float a = 3.0f;
+
+    const std::shared_ptr<const ResampleWeights> weightsV = ResampleWeightCache::getInstance().getLanczos (srcH, dstH, scale, a);
+    const std::shared_ptr<const ResampleWeights> weightsH = ResampleWeightCache::getInstance().getLanczos (srcW, dstW, scale, a);
+    const int supportH = weightsH->support;
+    // the horizontal pass reads up to support pixels past the last one, they stay zero
+    const int rowLen = srcW + supportH;
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        // vertically interpolated rows of the planes
+        std::vector<float> rows (planes * rowLen, 0.f);
+
+#ifdef _OPENMP
+        #pragma omp for
+#endif
+
+        for (int i = 0; i < dstH; i++) {
+            const int ii0 = weightsV->start[i];
+            const int taps = min (weightsV->support, srcH - ii0);
+
+            // Do vertical interpolation, along the rows
+            for (int p = 0; p < planes; p++) {
+                float* const row = &rows[p * rowLen];
+                const S* const first = src[p][ii0];
+                const float w0 = weightsV->get (i, 0);
+
+                for (int j = 0; j < srcW; j++) {
+                    row[j] = w0 * first[j];
+                }
+
+                for (int k = 1; k < taps; k++) {
+                    const S* const line = src[p][ii0 + k];
+                    const float wk = weightsV->get (i, k);
+
+                    for (int j = 0; j < srcW; j++) {
+                        row[j] += wk * line[j];
+                    }
+                }
+            }
+
+            // Do horizontal interpolation, lanes output pixels at a time
+            for (int j = 0; j < dstW; j += lanes) {
+                const int* const start = &weightsH->start[j];
+                const float* const w = &weightsH->weights[(j / lanes) * supportH * lanes];
+                const int count = min (lanes, dstW - j);
+
+                for (int p = 0; p < planes; p++) {
+                    const float* const row = &rows[p * rowLen];
+                    float acc[lanes] = {};
+
+                    for (int k = 0; k < supportH; k++) {
+                        for (int l = 0; l < lanes; l++) {
+                            acc[l] += w[k * lanes + l] * row[start[l] + k];
+                        }
+                    }
+
+                    D* const out = dst[p][i] + j;
+
+                    for (int l = 0; l < count; l++) {
+                        storeSample (acc[l], out[l]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template void Resampler::lanczos<unsigned short, unsigned short> (unsigned short** const src[], int srcW, int srcH, unsigned short** const dst[], int dstW, int dstH, int planes, float scale, bool boxPrescale);
+template void Resampler::lanczos<float, float> (float** const src[], int srcW, int srcH, float** const dst[], int dstW, int dstH, int planes, float scale, bool boxPrescale);
+template void Resampler::boxDownscale<unsigned short> (unsigned short** const src[], int srcW, int srcH, float** const dst[], int planes, int factor);
+template void Resampler::boxDownscale<float> (float** const src[], int srcW, int srcH, float** const dst[], int planes, int factor);
+
+}
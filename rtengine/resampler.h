@@ -0,0 +1,120 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "noncopyable.h"
+#include "../rtgui/threadutils.h"
+
+namespace rtengine
+{
+
+/**
+  * Weights of one axis of a separable resampling.
+  *
+  * The output pixels are grouped by lanes: the weights of the output pixels j to j + lanes - 1 are interleaved,
+  * weights[((j / lanes) * support + k) * lanes + j % lanes] being the weight of the source pixel start[j] + k.
+  * The unused taps have a zero weight, and start[j] + support never exceeds the source length plus support.
+  */
+struct ResampleWeights {
+    static constexpr int lanes = 8;
+
+    int srcLen;
+    int dstLen;
+    int support;
+    std::vector<int> start;     // padded to a multiple of lanes
+    std::vector<float> weights;
+
+    float get (int j, int k) const
+    {
+        return weights[((j / lanes) * support + k) * lanes + j % lanes];
+    }
+};
+
+/**
+  * Thread safe cache of the Lanczos weight tables, keyed by the lengths, the scale and the support.
+  * The batch queue exports many images of the same size, which then share their tables.
+  */
+class ResampleWeightCache final :
+    public NonCopyable
+{
+public:
+    static ResampleWeightCache& getInstance ();
+
+    std::shared_ptr<const ResampleWeights> getLanczos (int srcLen, int dstLen, float scale, float a);
+
+private:
+    struct Entry {
+        int srcLen;
+        int dstLen;
+        float scale;
+        float a;
+        std::shared_ptr<const ResampleWeights> weights;
+    };
+
+    static constexpr std::size_t maxEntries = 8;
+
+    ResampleWeightCache () = default;
+
+    static std::shared_ptr<const ResampleWeights> computeLanczos (int srcLen, int dstLen, float scale, float a);
+
+    MyMutex mutex;
+    std::list<Entry> entries; // most recently used first
+};
+
+/**
+  * Resampling engine shared by the resize and the transform.
+  *
+  * lanczos() does a vertical pass over full source rows followed by a horizontal pass whose weights are laid out
+  * lane by lane (see ResampleWeights), so both loops vectorize. With boxPrescale, downscales by 4 and more first
+  * average boxes of factor x factor pixels, leaving at least a 2x reduction to the Lanczos filter. That is about
+  * twice as fast but softens the output a little, so only the fast export uses it.
+  */
+class Resampler
+{
+public:
+    /// Resizes the first planes of src into dst. The planes are given by their row pointers.
+    template<typename S, typename D>
+    static void lanczos (S** const src[], int srcW, int srcH, D** const dst[], int dstW, int dstH, int planes, float scale, bool boxPrescale = false);
+
+    /// Averages blocks of factor x factor pixels, the last row and column of blocks may be partial
+    template<typename S>
+    static void boxDownscale (S** const src[], int srcW, int srcH, float** const dst[], int planes, int factor);
+
+    /// Weights of the 4 taps of the cubic convolution used by the transform, t being the fractional position
+    static inline void cubicWeights (double t, double w[4])
+    {
+        const double A = -0.85;
+
+        double t1 = -A * (t - 1.0) * t;
+        double t2 = (3.0 - 2.0 * t) * t * t;
+        w[3] = t1 * t;
+        w[2] = t1 * (t - 1.0) + t2;
+        w[1] = -t1 * t + 1.0 - t2;
+        w[0] = -t1 * (t - 1.0);
+    }
+
+private:
+    template<typename S, typename D>
+    static void lanczosPass (S** const src[], int srcW, int srcH, D** const dst[], int dstW, int dstH, int planes, float scale);
+};
+
+}
@@ -187,6 +187,9 @@ public:
     /** Returns a class providing access to the exif and iptc metadata tags of all frames of the image.
       * @return An instance of the FramesMetaData class */
     virtual const FramesMetaData* getMetaData () = 0;
+    /** Returns the amount of memory taken by the loaded image data.
+      * @return The size in bytes */
+    virtual unsigned long long getDataSize () = 0;
     /** This is a function used for internal purposes only. */
     virtual ImageSource* getImageSource () = 0;
     /** This class has manual reference counting. You have to call this function each time to make a new reference to an instance. */
@@ -554,8 +557,10 @@ public:
    * The ProcessingJob passed becomes invalid, you can not use it any more.
    * @param job the ProcessingJob to cancel.
    * @param bpl is the BatchProcessingListener that is called when the image is ready or the next job is needed. It also acts as a ProgressListener.
-   * @param tunnelMetaData tunnels IPTC and XMP to output without change */
-void startBatchProcessing (ProcessingJob* job, BatchProcessingListener* bpl, bool tunnelMetaData);
+   * @param tunnelMetaData tunnels IPTC and XMP to output without change
+   * @param numThreads is the maximum number of OpenMP threads used by this job, 0 means no limit. Several batch processings can run at the same time,
+   * this allows to split the cores between them. */
+void startBatchProcessing (ProcessingJob* job, BatchProcessingListener* bpl, bool tunnelMetaData, int numThreads = 0);
 
 
 extern MyMutex* lcmsMutex;
@@ -94,6 +94,14 @@ public:
     double          ed_lipampl;
 
     Glib::ustring   lensfunDbDirectory; ///< The directory containing the lensfun database. If empty, the system defaults will be used (as described in http://lensfun.sourceforge.net/manual/dbsearch.html)
+
+    Glib::ustring   demosaicCacheDir;   ///< Directory of the on-disk demosaic cache
+    int             demosaicCacheSize;  ///< Maximum size of the on-disk demosaic cache in MB, 0 disables the cache
+    int             batchStripHeight;   ///< Rows per strip when the batch pipeline runs the L*a*b* tools of large images in strips, 0 (default) disables strips. The output differs slightly from the unstripped one, see getStripHalo() in simpleprocess.cc
+    int             batchStripMinSize;  ///< Minimum image size in megapixels for strip processing in the batch pipeline
+    int             memoryBudget;       ///< Memory budget of the image buffers in MB, used to size the tiles of the memory hungry tools, 0 for no limit
+    int             bufferPoolSize;     ///< Maximum size in MB of the image buffers kept by the BufferPool for reuse, 0 disables the pool
+    bool            halfFloatStageCache; ///< Keep the cached outputs of the Lab stages of the preview and of the detail windows as half floats
     
     /** Creates a new instance of Settings.
       * @return a pointer to the new Settings instance. */
@@ -29,6 +29,11 @@
 #include "rawimagesource.h"
 #include "../rtgui/multilangmgr.h"
 #include "mytime.h"
+#include "memorybudget.h"
+#include "bufferpool.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #undef THREAD_PRIORITY_NORMAL
 
 namespace rtengine
@@ -62,6 +67,7 @@ public:
         imgsrc (nullptr),
         fw (-1),
         fh (-1),
+        rawSkip (1),
         pp (0, 0, 0, 0, 0)
     {
     }
@@ -78,13 +84,21 @@ public:
 private:
     Image16 *normal_pipeline()
     {
+        MemoryBudget::PeakScope memoryPeak;
+
         if (!stage_init()) {
             return nullptr;
         }
 
+        memoryPeak.report ("loading and demosaicing");
         stage_denoise();
+        memoryPeak.report ("noise reduction");
         stage_transform();
-        return stage_finish();
+        memoryPeak.report ("transformation");
+        Image16 *readyImg = stage_finish();
+        memoryPeak.report ("color and detail processing");
+        BufferPool::getInstance().reportStats ();
+        return readyImg;
     }
 
     Image16 *fast_pipeline()
@@ -95,14 +109,23 @@ private:
 
         pl = nullptr;
 
+        MemoryBudget::PeakScope memoryPeak;
+
         if (!stage_init()) {
             return nullptr;
         }
 
+        memoryPeak.report ("loading and demosaicing");
         stage_transform();
+        memoryPeak.report ("transformation");
         stage_early_resize();
+        memoryPeak.report ("resizing");
         stage_denoise();
-        return stage_finish();
+        memoryPeak.report ("noise reduction");
+        Image16 *readyImg = stage_finish();
+        memoryPeak.report ("color and detail processing");
+        BufferPool::getInstance().reportStats ();
+        return readyImg;
     }
 
     bool stage_init()
@@ -186,7 +209,24 @@ private:
             pl->setProgress (0.20);
         }
 
-        imgsrc->demosaic ( params.raw);
+        // large downscales of the fast export bin the raw data, and the pipeline works on the binned image from there
+        rawSkip = getRawSkip();
+
+        if (rawSkip > 1 && imgsrc->demosaicBinned (params.raw, tr, PreviewProps (0, 0, fw, fh, rawSkip))) {
+            pp = PreviewProps (0, 0, fw, fh, rawSkip);
+            imgsrc->getSize (pp, fw, fh);
+            params.crop.x /= rawSkip;
+            params.crop.y /= rawSkip;
+            params.crop.w /= rawSkip;
+            params.crop.h /= rawSkip;
+
+            if (params.resize.dataspec == 0) {
+                params.resize.scale *= rawSkip;
+            }
+        } else {
+            rawSkip = 1;
+            imgsrc->demosaic ( params.raw);
+        }
 
         if (pl) {
             pl->setProgress (0.30);
@@ -732,6 +772,24 @@ private:
         return true;
     }
 
+    // skip of the raw binning of the fast export, when the resize reduces the image 4 times or more
+    int getRawSkip()
+    {
+        procparams::ProcParams& params = job->pparams;
+
+        // these read the full resolution rgb data
+        if (!job->fast || !params.resize.enabled || params.retinex.enabled || params.dirpyrDenoise.enabled
+                || (params.toneCurve.hrenabled && params.toneCurve.method == "Color")) {
+            return 1;
+        }
+
+        int imw, imh;
+        const double scale = ipf_p->resizeScale (&params, fw, fh, imw, imh);
+
+        // at least a 2x reduction is left to the Lanczos resize
+        return scale <= 0.25 ? static_cast<int> (0.5 / scale) : 1;
+    }
+
     void stage_denoise()
     {
         procparams::ProcParams& params = job->pparams;
@@ -899,8 +957,6 @@ private:
             CurveFactory::curveToning (params.colorToning.cl2curve, cl2Toningcurve, 1);
         }
 
-        labView = new LabImage (fw, fh);
-
         if (params.blackwhite.enabled) {
             CurveFactory::curveBW (params.blackwhite.beforeCurve, params.blackwhite.afterCurve, hist16, dummy, customToneCurvebw1, customToneCurvebw2, 1);
         }
@@ -933,6 +989,14 @@ private:
         DCPProfile::ApplyState as;
         DCPProfile *dcpProf = imgsrc->getDCP (params.icm, currWB, as);
 
+        const int stripHeight = getStripHeight();
+
+        if (stripHeight > 0) {
+            return stage_finish_strips (stripHeight, satLimit, satLimitOpacity, opautili, dcpProf, as);
+        }
+
+        labView = new LabImage (fw, fh);
+
         LUTu histToneCurve;
 
         ipf.rgbProc (baseImg, labView, nullptr, curve1, curve2, curve, shmap, params.toneCurve.saturation, rCurve, gCurve, bCurve, satLimit, satLimitOpacity, ctColorCurve, ctOpacityCurve, opautili, clToningcurve, cl2Toningcurve, customToneCurve1, customToneCurve2, customToneCurvebw1, customToneCurvebw2, rrm, ggm, bbm, autor, autog, autob, expcomp, hlcompr, hlcomprthresh, dcpProf, as, histToneCurve);
@@ -1266,6 +1330,263 @@ private:
 
 
 
+        return stage_output (readyImg, imw, imh, tmpScale, bwonly, customGamma, useLCMS, jprof);
+    }
+
+    // Returns the number of rows per strip when the L*a*b* tools of this image can be applied strip by strip, 0 otherwise
+    int getStripHeight()
+    {
+        const procparams::ProcParams& params = job->pparams;
+
+        if (settings->batchStripHeight <= 0 || double (fw) * fh < settings->batchStripMinSize * 1000000.0) {
+            return 0;
+        }
+
+        // these tools work on image wide statistics or need the whole image for another reason
+        if (params.sh.enabled || params.colorappearance.enabled || params.epd.enabled || params.wavelet.enabled || params.defringe.enabled
+                || (params.blackwhite.enabled && params.blackwhite.autoc)) {
+            return 0;
+        }
+
+        // the Lanczos resize is done on the L*a*b* data of the whole image
+        int imw, imh;
+        const double tmpScale = ipf_p->resizeScale (&params, fw, fh, imw, imh);
+
+        if (params.resize.enabled && params.resize.method != "Nearest" && tmpScale != 1.0) {
+            return 0;
+        }
+
+        return settings->batchStripHeight;
+    }
+
+    // Returns the number of rows a strip is extended by so that the local tools give nearly the same result at its borders as on the
+    // whole image. The halos are approximations: the Gaussian blurs of the sharpening tools are recursive (IIR) filters which reach
+    // further, so the stripped output differs slightly from the unstripped one. That's why strips are off by default.
+    int getStripHalo()
+    {
+        const procparams::ProcParams& params = job->pparams;
+        int halo = 0;
+
+        if (params.impulseDenoise.enabled) {
+            halo = max (halo, 16);
+        }
+
+        if (params.sharpenEdge.enabled) {
+            halo = max (halo, 2 * params.sharpenEdge.passes + 2);
+        }
+
+        if (params.sharpenMicro.enabled) {
+            halo = max (halo, 8);
+        }
+
+        if (params.sharpening.enabled) {
+            if (params.sharpening.method == "rld") {
+                halo = max (halo, int (ceil (3.0 * params.sharpening.deconvradius * sqrt (double (params.sharpening.deconviter)))) + 2);
+            } else {
+                int usmHalo = int (ceil (3.0 * params.sharpening.radius)) + 2;
+
+                if (params.sharpening.edgesonly) {
+                    usmHalo += int (ceil (2.0 * params.sharpening.edges_radius));
+                }
+
+                halo = max (halo, usmHalo);
+            }
+        }
+
+        if (params.dirpyrequalizer.enabled && params.dirpyrequalizer.cbdlMethod == "aft") {
+            halo = max (halo, 128); // 5x5 kernel on 6 levels of scale 1 to 32
+        }
+
+        return halo;
+    }
+
+    void copyStrip (Imagefloat *strip, int top)
+    {
+        for (int i = 0; i < strip->getHeight(); i++) {
+            memcpy (strip->r (i), baseImg->r (top + i), fw * sizeof (float));
+            memcpy (strip->g (i), baseImg->g (top + i), fw * sizeof (float));
+            memcpy (strip->b (i), baseImg->b (top + i), fw * sizeof (float));
+        }
+    }
+
+    // Same as the end of stage_finish, but with the L*a*b* tools applied to overlapping strips of the image,
+    // so that only baseImg and the output image are allocated at full size
+    Image16 *stage_finish_strips (int stripHeight, float satLimit, float satLimitOpacity, bool opautili, DCPProfile *dcpProf, const DCPProfile::ApplyState &as)
+    {
+        procparams::ProcParams& params = job->pparams;
+        ImProcFunctions &ipf = * (ipf_p.get());
+
+        const int halo = getStripHalo();
+
+        if (settings->verbose) {
+            printf ("Processing the L*a*b* tools in strips of %d rows (halo: %d rows)\n", stripHeight, halo);
+        }
+
+        double rrm, ggm, bbm;
+        float autor = 0.f, autog, autob; // no "auto" values for the B&W tool, they need the whole image
+        LUTu histToneCurve;
+
+        if (params.labCurve.contrast != 0) { //only use hist16 for contrast
+            // the histogram has to be built from the whole image before the first strip can be processed
+            hist16.clear();
+
+            for (int y = 0; y < fh; y += stripHeight) {
+                const int h = min (stripHeight, fh - y);
+                Imagefloat strip (fw, h);
+                LabImage labStrip (fw, h, true);
+                copyStrip (&strip, y);
+                ipf.rgbProc (&strip, &labStrip, nullptr, curve1, curve2, curve, nullptr, params.toneCurve.saturation, rCurve, gCurve, bCurve, satLimit, satLimitOpacity, ctColorCurve, ctOpacityCurve, opautili, clToningcurve, cl2Toningcurve, customToneCurve1, customToneCurve2, customToneCurvebw1, customToneCurvebw2, rrm, ggm, bbm, autor, autog, autob, expcomp, hlcompr, hlcomprthresh, dcpProf, as, histToneCurve);
+
+#ifdef _OPENMP
+                #pragma omp parallel
+#endif
+                {
+                    LUTu hist16thr (hist16.getSize());  // one temporary lookup table per thread
+                    hist16thr.clear();
+#ifdef _OPENMP
+                    #pragma omp for schedule(static) nowait
+#endif
+
+                    for (int i = 0; i < h; i++)
+                        for (int j = 0; j < fw; j++) {
+                            hist16thr[ (int) ((labStrip.L[i][j]))]++;
+                        }
+
+                    #pragma omp critical
+                    {
+                        hist16 += hist16thr;
+                    }
+                }
+            }
+        }
+
+        bool utili;
+        CurveFactory::complexLCurve (params.labCurve.brightness, params.labCurve.contrast, params.labCurve.lcurve, hist16, lumacurve, dummy, 1, utili);
+
+        bool clcutili;
+        CurveFactory::curveCL (clcutili, params.labCurve.clcurve, clcurve, 1);
+
+        bool ccutili, cclutili;
+        // unlike stage_finish, curve1 and curve2 are still needed by rgbProc and can't hold the a and b curves
+        LUTf acurve (65536);
+        LUTf bcurve (65536);
+        CurveFactory::complexsgnCurve (autili, butili, ccutili, cclutili, params.labCurve.acurve, params.labCurve.bcurve, params.labCurve.cccurve,
+                                       params.labCurve.lccurve, acurve, bcurve, satcurve, lhskcurve, 1);
+
+        // crop and convert to rgb16
+        int cx = 0, cy = 0, cw = fw, ch = fh;
+
+        if (params.crop.enabled) {
+            cx = params.crop.x;
+            cy = params.crop.y;
+            cw = params.crop.w;
+            ch = params.crop.h;
+        }
+
+        Image16* readyImg = new Image16 (cw, ch);
+        cmsHPROFILE jprof = nullptr;
+        bool customGamma = params.icm.gamma != "default" || params.icm.freegamma;
+        bool useLCMS = false;
+        bool bwonly = params.blackwhite.enabled && !params.colorToning.enabled && !autili && !butili ;
+        GammaValues ga;
+
+        for (int y = cy; y < cy + ch; y += stripHeight) {
+            const int y2 = min (y + stripHeight, cy + ch);
+            const int top = max (y - halo, 0);
+            const int h = min (y2 + halo, fh) - top;
+
+            LabImage labStrip (fw, h, true);
+            {
+                Imagefloat strip (fw, h);
+                copyStrip (&strip, top);
+                ipf.rgbProc (&strip, &labStrip, nullptr, curve1, curve2, curve, nullptr, params.toneCurve.saturation, rCurve, gCurve, bCurve, satLimit, satLimitOpacity, ctColorCurve, ctOpacityCurve, opautili, clToningcurve, cl2Toningcurve, customToneCurve1, customToneCurve2, customToneCurvebw1, customToneCurvebw2, rrm, ggm, bbm, autor, autog, autob, expcomp, hlcompr, hlcomprthresh, dcpProf, as, histToneCurve);
+            }
+
+            ipf.chromiLuminanceCurve (nullptr, 1, &labStrip, &labStrip, acurve, bcurve, satcurve, lhskcurve, clcurve, lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, dummy, dummy);
+            ipf.vibrance (&labStrip);
+            ipf.impulsedenoise (&labStrip);
+
+            if (params.sharpenEdge.enabled) {
+                ipf.MLsharpen (&labStrip);
+            }
+
+            if (params.sharpenMicro.enabled) {
+                ipf.MLmicrocontrast (&labStrip);
+            }
+
+            if (params.sharpening.enabled) {
+                float **buffer = new float*[h];
+
+                for (int i = 0; i < h; i++) {
+                    buffer[i] = new float[fw];
+                }
+
+                ipf.sharpening (&labStrip, (float**)buffer, params.sharpening);
+
+                for (int i = 0; i < h; i++) {
+                    delete [] buffer[i];
+                }
+
+                delete [] buffer;
+            }
+
+            if (params.dirpyrequalizer.cbdlMethod == "aft") {
+                ipf.dirpyrequalizer (&labStrip, 1);
+            }
+
+            Image16* stripImg = ipf.lab2rgb16 (&labStrip, cx, y - top, cw, y2 - y, params.icm, bwonly, customGamma ? &ga : nullptr);
+
+            for (int i = 0; i < y2 - y; i++) {
+                memcpy (readyImg->r (y - cy + i), stripImg->r (i), cw * sizeof (unsigned short));
+                memcpy (readyImg->g (y - cy + i), stripImg->g (i), cw * sizeof (unsigned short));
+                memcpy (readyImg->b (y - cy + i), stripImg->b (i), cw * sizeof (unsigned short));
+            }
+
+            delete stripImg;
+
+            if (pl) {
+                pl->setProgress (0.55 + 0.15 * (y2 - cy) / ch);
+            }
+        }
+
+        if (customGamma) {
+            if ((jprof = ICCStore::getInstance()->createCustomGammaOutputProfile (params.icm, ga)) == nullptr) {
+                useLCMS = true;
+            }
+        } else if (settings->verbose) {
+            printf ("Output profile_: \"%s\"\n", params.icm.output.c_str());
+        }
+
+        // if clut was used and size of clut cache == 1 we free the memory used by the clutstore (default clut cache size = 1 for 32 bit OS)
+        if ( params.filmSimulation.enabled && !params.filmSimulation.clutFilename.empty() && options.clutCacheSize == 1) {
+            CLUTStore::getInstance().clearCache();
+        }
+
+        customToneCurve1.Reset();
+        customToneCurve2.Reset();
+        ctColorCurve.Reset();
+        ctOpacityCurve.Reset();
+        noiseLCurve.Reset();
+        noiseCCurve.Reset();
+        customToneCurvebw1.Reset();
+        customToneCurvebw2.Reset();
+
+        delete baseImg;
+        baseImg = nullptr;
+
+        int imw, imh;
+        double tmpScale = ipf.resizeScale (&params, fw, fh, imw, imh);
+
+        return stage_output (readyImg, imw, imh, tmpScale, bwonly, customGamma, useLCMS, jprof);
+    }
+
+    Image16 *stage_output (Image16 *readyImg, int imw, int imh, double tmpScale, bool bwonly, bool customGamma, bool useLCMS, cmsHPROFILE jprof)
+    {
+        procparams::ProcParams& params = job->pparams;
+        ImProcFunctions &ipf = * (ipf_p.get());
+        const int cw = readyImg->getWidth();
+        const int ch = readyImg->getHeight();
+
         if (bwonly) { //force BW r=g=b
             if (settings->verbose) {
                 printf ("Force BW\n");
@@ -1397,11 +1718,12 @@ private:
         // resize image
         {
             std::unique_ptr<LabImage> resized (new LabImage (imw, imh));
-            ipf.Lanczos (tmplab.get(), resized.get(), scale_factor);
+            // the fast export trades a little sharpness of large downscales for speed
+            ipf.Lanczos (tmplab.get(), resized.get(), scale_factor, true);
             tmplab = std::move (resized);
         }
 
-        adjust_procparams (scale_factor);
+        adjust_procparams (scale_factor / rawSkip);
 
         fw = imw;
         fh = imh;
@@ -1504,6 +1826,7 @@ private:
     ImageSource *imgsrc;
     int fw;
     int fh;
+    int rawSkip;  // binning of the raw data, 1 if none
 
     int tr;
     PreviewProps pp;
@@ -1575,9 +1898,16 @@ IImage16* processImage (ProcessingJob* pjob, int& errorCode, ProgressListener* p
     return proc();
 }
 
-void batchProcessingThread (ProcessingJob* job, BatchProcessingListener* bpl, bool tunnelMetaData)
+void batchProcessingThread (ProcessingJob* job, BatchProcessingListener* bpl, bool tunnelMetaData, int numThreads)
 {
 
+#ifdef _OPENMP
+    // the number of threads is a per thread setting, so it only affects the parallel regions started by this job
+    if (numThreads > 0) {
+        omp_set_num_threads (numThreads);
+    }
+#endif
+
     ProcessingJob* currentJob = job;
 
     while (currentJob) {
@@ -1598,11 +1928,11 @@ void batchProcessingThread (ProcessingJob* job, BatchProcessingListener* bpl, bo
     }
 }
 
-void startBatchProcessing (ProcessingJob* job, BatchProcessingListener* bpl, bool tunnelMetaData)
+void startBatchProcessing (ProcessingJob* job, BatchProcessingListener* bpl, bool tunnelMetaData, int numThreads)
 {
 
     if (bpl) {
-        Glib::Thread::create (sigc::bind (sigc::ptr_fun (batchProcessingThread), job, bpl, tunnelMetaData), 0, true, true, Glib::THREAD_PRIORITY_LOW);
+        Glib::Thread::create (sigc::bind (sigc::ptr_fun (batchProcessingThread), job, bpl, tunnelMetaData, numThreads), 0, true, true, Glib::THREAD_PRIORITY_LOW);
     }
 
 }
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////
+//
+//  8 and 16 floats wide counterparts of vfloat for the MULTIVERSION kernels
+//
+//  vfloat8 and vfloat16 are generic GCC vectors. A kernel using them is compiled for AVX2 (vfloat8, one ymm
+//  register) and AVX-512 (vfloat16, one zmm register) with "#pragma GCC target", see amaze_wide.h, and the
+//  MULTIVERSION function calls the version matching getDispatchedSimdWidth(). The rest of a row is handled by
+//  the 4 wide vfloat code.
+//
+//  No include guard: this file is included once per instruction set, in the namespace of the kernels and under the
+//  matching "#pragma GCC target", like the kernels themselves. The helpers are then compiled for the instruction set
+//  of the kernels calling them. Defined for the baseline, the helpers returning wide vectors would have an ABI
+//  depending on AVX and GCC would warn about it (-Wpsabi).
+//
+//  The helpers mirror those of sleefsseavx.c and have the same semantics lane by lane.
+//
+//  this is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////
+
+#ifdef CPU_DISPATCH
+
+// always inlined into the kernels. Redefined identically by each inclusion
+#define WIDEINLINE inline __attribute__ ((always_inline))
+
+typedef float vfloat8 __attribute__ ((vector_size (32)));
+typedef int vmask8 __attribute__ ((vector_size (32)));
+typedef float vfloat16 __attribute__ ((vector_size (64)));
+typedef int vmask16 __attribute__ ((vector_size (64)));
+
+template<typename V>
+struct VectorTraits;
+
+template<>
+struct VectorTraits<vfloat8> {
+    typedef vmask8 mask;
+    static constexpr int width = 8;
+};
+
+template<>
+struct VectorTraits<vfloat16> {
+    typedef vmask16 mask;
+    static constexpr int width = 16;
+};
+
+// loads and stores don't need any alignment
+template<typename V>
+WIDEINLINE V LVFUN (const float &x)
+{
+    V result;
+    __builtin_memcpy (&result, &x, sizeof (V));
+    return result;
+}
+
+template<typename V>
+WIDEINLINE void STVFUN (float &x, const V &y)
+{
+    __builtin_memcpy (&x, &y, sizeof (V));
+}
+
+// loads 2 * width floats from a and combines a[0], a[2], a[4] ... into a vector
+template<typename V>
+WIDEINLINE V LC2VFUN (const float &a)
+{
+    // constant once inlined, GCC turns the shuffle into a permutation of the two vectors
+    typename VectorTraits<V>::mask even;
+
+    for (int i = 0; i < VectorTraits<V>::width; ++i) {
+        even[i] = 2 * i;
+    }
+
+    return __builtin_shuffle (LVFUN<V> (a), LVFUN<V> ((&a)[VectorTraits<V>::width]), even);
+}
+
+// loads 2 * width floats from a and returns { a[0] + a[1], a[2] + a[3] ... }
+template<typename V>
+WIDEINLINE V vaddc2vfun (const float &a)
+{
+    return LC2VFUN<V> (a) + LC2VFUN<V> ((&a)[1]);
+}
+
+template<typename V>
+WIDEINLINE V F2VN (float a)
+{
+    return V {} + a;
+}
+
+// v[2 * i] = even, v[2 * i + 1] = odd
+template<typename V>
+WIDEINLINE V F2VN (float even, float odd)
+{
+    V result;
+
+    for (int i = 0; i < VectorTraits<V>::width; i += 2) {
+        result[i] = even;
+        result[i + 1] = odd;
+    }
+
+    return result;
+}
+
+template<typename V>
+WIDEINLINE V vabsfn (const V &a)
+{
+    typedef typename VectorTraits<V>::mask M;
+    return reinterpret_cast<V> (reinterpret_cast<M> (a) & 0x7fffffff);
+}
+
+// same operand order as _mm_max_ps / _mm_min_ps: y is returned when one of them is NaN
+template<typename V>
+WIDEINLINE V vmaxfn (const V &x, const V &y)
+{
+    return x > y ? x : y;
+}
+
+template<typename V>
+WIDEINLINE V vminfn (const V &x, const V &y)
+{
+    return x < y ? x : y;
+}
+
+// bitwise like vself: GCC handles "mask ? x : y" on a materialized 16 lanes mask element by element
+template<typename V, typename M>
+WIDEINLINE V vselfn (const M &mask, const V &x, const V &y)
+{
+    return reinterpret_cast<V> ((mask & reinterpret_cast<M> (x)) | (~mask & reinterpret_cast<M> (y)));
+}
+
+template<typename V>
+WIDEINLINE V SQRVN (const V &a)
+{
+    return a * a;
+}
+
+template<typename V>
+WIDEINLINE V vintpfn (const V &a, const V &b, const V &c)
+{
+    // calculate a * b + (1 - a) * c (interpolate two values)
+    return a * (b - c) + c;
+}
+
+template<typename V>
+WIDEINLINE V vadivapbn (const V &a, const V &b)
+{
+    return a / (a + b);
+}
+
+#endif
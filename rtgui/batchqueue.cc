@@ -35,11 +35,128 @@
 #include "guiutils.h"
 #include "rtimage.h"
 #include <sys/time.h>
+#include <fcntl.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace rtengine;
 
-BatchQueue::BatchQueue (FileCatalog* aFileCatalog) : processing(nullptr), fileCatalog(aFileCatalog), sequence(0), listener(nullptr)
+namespace
+{
+
+// rough peak memory needed per output pixel by the processing pipeline (raw data, rgb planes, Lab and intermediate buffers)
+constexpr unsigned long long bytesPerPixel = 64;
+
+// maximum number of processed images waiting for the output writer, the jobs wait when it is reached
+constexpr std::size_t maxQueuedOutputs = 2;
+
+// best effort to get the written file to the disk before the image is reported as saved
+void syncFile (const Glib::ustring& fname)
+{
+#ifdef WIN32
+    const int fd = g_open (fname.c_str (), O_RDWR | O_BINARY, 0);
+#else
+    const int fd = g_open (fname.c_str (), O_RDONLY, 0);
+#endif
+
+    if (fd < 0) {
+        return;
+    }
+
+#ifdef WIN32
+    _commit (fd);
+#else
+    fsync (fd);
+#endif
+    close (fd);
+}
+
+unsigned long long getPhysicalMemory ()
+{
+#ifdef WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof (status);
+    return GlobalMemoryStatusEx (&status) ? status.ullTotalPhys : 0;
+#elif defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+    const long pages = sysconf (_SC_PHYS_PAGES);
+    const long pageSize = sysconf (_SC_PAGE_SIZE);
+    return pages > 0 && pageSize > 0 ? static_cast<unsigned long long> (pages) * pageSize : 0;
+#else
+    return 0;
+#endif
+}
+
+int getNumProcs ()
+{
+#ifdef _OPENMP
+    return omp_get_num_procs ();
+#else
+    return 1;
+#endif
+}
+
+double imagesPerMinute (int images, std::chrono::steady_clock::duration elapsed)
+{
+    const double seconds = std::chrono::duration<double> (elapsed).count ();
+    return seconds > 0.0 ? images * 60.0 / seconds : 0.0;
+}
+
+}
+
+// Runs the batch processing of one image at a time, several workers can run concurrently
+class BatchQueue::Worker final :
+    public rtengine::BatchProcessingListener
+{
+public:
+    Worker (BatchQueue& queue, int id) :
+        queue (queue),
+        id (id),
+        entry (nullptr),
+        fast (false),
+        threads (0),
+        imagesDone (0),
+        busyTime (std::chrono::steady_clock::duration::zero ())
+    {
+    }
+
+    rtengine::ProcessingJob* imageReady (rtengine::IImage16* img)
+    {
+        return queue.imageReady (*this, img);
+    }
+
+    void error (Glib::ustring msg)
+    {
+        queue.error (*this, msg);
+    }
+
+    void setProgress (double p)
+    {
+        queue.setProgress (*this, p);
+    }
+
+    BatchQueue& queue;
+    const int id;
+    BatchQueueEntry* entry; // the image being processed, nullptr when idle
+    bool fast; // the entry uses the fast export pipeline, its job is deleted by the processing
+    int threads; // OpenMP thread budget of the running batch processing thread
+    int imagesDone;
+    std::chrono::steady_clock::time_point entryStarted;
+    std::chrono::steady_clock::duration busyTime;
+};
+
+BatchQueue::BatchQueue (FileCatalog* aFileCatalog) :
+    jobFootprint(0), imagesDone(0),
+    prefetcher(nullptr), prefetching(false), stopPrefetch(false), prefetchedBytes(0), prefetchEstimate(0),
+    writer(nullptr), stopWriter(false), outputsPending(0),
+    fileCatalog(aFileCatalog), sequence(0), listener(nullptr)
 {
 
     location = THLOC_BATCHQUEUE;
@@ -86,8 +203,28 @@ BatchQueue::BatchQueue (FileCatalog* aFileCatalog) : processing(nullptr), fileCa
 
 BatchQueue::~BatchQueue ()
 {
+    {
+        // let the output writer finish the pending images
+        Glib::Threads::Mutex::Lock lock (outputQueueMutex);
+        stopWriter = true;
+        outputQueueCond.broadcast ();
+    }
+
+    if (writer) {
+        writer->join ();
+    }
+
     idle_register.destroy();
 
+    {
+        MYWRITERLOCK(l, entryRW);
+        stopPrefetch = true;
+    }
+
+    if (prefetcher) {
+        prefetcher->join ();
+    }
+
     MYWRITERLOCK(l, entryRW);
 
     // The listener merges parameters with old values, so delete afterwards
@@ -412,6 +549,7 @@ void BatchQueue::cancelItems (const std::vector<ThumbBrowserEntryBase*>& items)
 
             fd.erase (pos);
 
+            prefetchedBytes -= entry->prefetchedBytes;
             rtengine::ProcessingJob::destroy (entry->job);
 
             if (entry->thumbnail)
@@ -542,138 +680,385 @@ void BatchQueue::openItemInEditor(ThumbBrowserEntryBase* item)
 }
 
 
-void BatchQueue::startProcessing ()
+int BatchQueue::getMaxConcurrentJobs () const
 {
+    const int numProcs = getNumProcs ();
 
-    if (!processing) {
-        MYWRITERLOCK(l, entryRW);
+    if (options.batchQueueJobs > 0) {
+        return std::min (options.batchQueueJobs, numProcs);
+    }
 
-        if (!fd.empty()) {
-            BatchQueueEntry* next;
+    // automatic mode: as long as the memory needed by an image is unknown, process one image at a time
+    if (jobFootprint == 0) {
+        return 1;
+    }
 
-            next = static_cast<BatchQueueEntry*>(fd[0]);
-            // tag it as processing and set sequence
-            next->processing = true;
-            next->sequence = sequence = 1;
-            processing = next;
+    // the processing of a single image doesn't scale well beyond 8 cores
+    int jobs = std::max (1, numProcs / 8);
 
-            // remove from selection
-            if (processing->selected) {
-                std::vector<ThumbBrowserEntryBase*>::iterator pos = std::find (selected.begin(), selected.end(), processing);
+    // leave half of the memory to the rest of the system and to the editor
+    const unsigned long long memory = getPhysicalMemory ();
 
-                if (pos != selected.end()) {
-                    selected.erase (pos);
-                }
+    if (memory > 0) {
+        jobs = static_cast<int> (std::min<unsigned long long> (jobs, std::max<unsigned long long> (1, memory / 2 / jobFootprint)));
+    }
 
-                processing->selected = false;
-            }
+    return jobs;
+}
 
-            MYWRITERLOCK_RELEASE(l);
+int BatchQueue::getThreadsPerJob (int jobs) const
+{
+    return std::max (1, getNumProcs () / std::max (1, jobs));
+}
 
-            // remove button set
-            next->removeButtonSet ();
+int BatchQueue::getBusyWorkers () const
+{
+    return std::count_if (workers.begin (), workers.end (), [] (const std::unique_ptr<Worker>& worker) { return worker->entry != nullptr; });
+}
 
-            // start batch processing
-            rtengine::startBatchProcessing (next->job, this, options.tunnelMetaData);
-            queue_draw ();
+// Tags the first waiting entry of the queue as processed by the given worker.
+// The entry list has to be write locked by the caller. Returns nullptr if no entry is waiting.
+BatchQueueEntry* BatchQueue::assignNextEntry (Worker& worker)
+{
+    const auto pos = std::find_if (fd.begin (), fd.end (), [] (const ThumbBrowserEntryBase* fdEntry) { return !fdEntry->processing; });
+
+    if (pos == fd.end ()) {
+        worker.entry = nullptr;
+        return nullptr;
+    }
+
+    BatchQueueEntry* next = static_cast<BatchQueueEntry*>(*pos);
+    // the memory of a prefetched image now belongs to the running job
+    prefetchedBytes -= next->prefetchedBytes;
+    next->prefetchedBytes = 0;
+    // tag it as processing and set sequence
+    next->processing = true;
+    next->sequence = ++sequence;
+    worker.entry = next;
+    worker.fast = next->job->fastPipeline ();
+    worker.entryStarted = std::chrono::steady_clock::now ();
+
+    // remove from selection
+    if (next->selected) {
+        std::vector<ThumbBrowserEntryBase*>::iterator selPos = std::find (selected.begin(), selected.end(), next);
+
+        if (selPos != selected.end()) {
+            selected.erase (selPos);
         }
+
+        next->selected = false;
     }
+
+    return next;
 }
 
-rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
+// Starts idle workers on the waiting entries, as long as the number of concurrent jobs allows it
+void BatchQueue::startIdleWorkers (bool fromGuiThread)
 {
+    std::vector<Worker*> started;
+    int threadsPerJob;
+    int busyWorkers;
 
-    // save image img
-    Glib::ustring fname;
-    SaveFormat saveFormat;
+    {
+        MYWRITERLOCK(l, entryRW);
+
+        const int maxJobs = getMaxConcurrentJobs ();
+        threadsPerJob = getThreadsPerJob (maxJobs);
+
+        while (static_cast<int> (workers.size ()) < maxJobs) {
+            workers.emplace_back (new Worker (*this, workers.size () + 1));
+        }
+
+        for (int busy = getBusyWorkers (); busy < maxJobs; ++busy) {
+            const auto idle = std::find_if (workers.begin (), workers.end (), [] (const std::unique_ptr<Worker>& worker) { return worker->entry == nullptr; });
+
+            if (idle == workers.end () || !assignNextEntry (**idle)) {
+                break;
+            }
+
+            (*idle)->threads = threadsPerJob;
+            started.push_back (idle->get ());
+        }
 
-    if (processing->outFileName == "") { // auto file name
-        Glib::ustring s = calcAutoFileNameBase (processing->filename, processing->sequence);
-        saveFormat = options.saveFormatBatch;
-        fname = autoCompleteFileName (s, saveFormat.format);
-    } else { // use the save-as filename with automatic completion for uniqueness
-        if (processing->forceFormatOpts) {
-            saveFormat = processing->saveFormat;
+        busyWorkers = getBusyWorkers ();
+    }
+
+    if (started.empty ()) {
+        return;
+    }
+
+    if (options.rtSettings.verbose) {
+        printf ("Batch queue: %d concurrent job(s), %d thread(s) per job\n", busyWorkers, threadsPerJob);
+    }
+
+    for (const auto worker : started) {
+        // remove button set
+        if (fromGuiThread) {
+            worker->entry->removeButtonSet ();
         } else {
-            saveFormat = options.saveFormatBatch;
+            // ButtonSet have Cairo::Surface which might be rendered while we're trying to delete them
+            GThreadLock lock;
+            worker->entry->removeButtonSet ();
         }
 
-        // The output filename's extension is forced to the current or selected output format,
-        // despite what the user have set in the fielneame's field of the "Save as" dialgo box
-        fname = autoCompleteFileName (removeExtension(processing->outFileName), saveFormat.format);
-        //fname = autoCompleteFileName (removeExtension(processing->outFileName), getExtension(processing->outFileName));
+        // start batch processing
+        rtengine::startBatchProcessing (worker->entry->job, worker, options.tunnelMetaData, threadsPerJob);
     }
 
-    //printf ("fname=%s, %s\n", fname.c_str(), removeExtension(fname).c_str());
+    startPrefetch ();
 
-    if (img && fname != "") {
-        int err = 0;
+    if (fromGuiThread) {
+        queue_draw ();
+    } else {
+        redraw ();
+    }
+}
+
+// Returns the next waiting entry to load in advance, if the memory limit allows it.
+// The entry list has to be locked by the caller.
+BatchQueueEntry* BatchQueue::getPrefetchCandidate ()
+{
+    const unsigned long long maxBytes = static_cast<unsigned long long> (std::max (options.batchQueuePrefetchMemory, 0)) * 1024 * 1024;
+
+    if (stopPrefetch || getBusyWorkers () == 0 || prefetchedBytes + prefetchEstimate > maxBytes) {
+        return nullptr;
+    }
 
-        if (saveFormat.format == "tif") {
-            err = img->saveAsTIFF (fname, saveFormat.tiffBits, saveFormat.tiffUncompressed);
-        } else if (saveFormat.format == "png") {
-            err = img->saveAsPNG (fname, saveFormat.pngCompression, saveFormat.pngBits);
-        } else if (saveFormat.format == "jpg") {
-            err = img->saveAsJPEG (fname, saveFormat.jpegQuality, saveFormat.jpegSubSamp);
+    // only look at the entries which will be processed next
+    int waiting = 0;
+    const int maxWaiting = getMaxConcurrentJobs ();
+
+    for (const auto fdEntry : fd) {
+        if (fdEntry->processing) {
+            continue;
         }
 
-        img->free ();
+        BatchQueueEntry* const entry = static_cast<BatchQueueEntry*>(fdEntry);
 
-        if (err) {
-            throw Glib::FileError(Glib::FileError::FAILED, M("MAIN_MSG_CANNOTSAVE") + "\n" + fname);
+        if (!entry->prefetched) {
+            return entry;
         }
 
-        if (saveFormat.saveParams) {
-            // We keep the extension to avoid overwriting the profile when we have
-            // the same output filename with different extension
-            //processing->params.save (removeExtension(fname) + paramFileExtension);
-            processing->params.save (fname + ".out" + paramFileExtension);
+        if (++waiting >= maxWaiting) {
+            break;
         }
+    }
 
-        if (processing->thumbnail) {
-            processing->thumbnail->imageDeveloped ();
-            processing->thumbnail->imageRemovedFromQueue ();
+    return nullptr;
+}
+
+void BatchQueue::startPrefetch ()
+{
+    MYWRITERLOCK(l, entryRW);
+
+    if (prefetching || !getPrefetchCandidate ()) {
+        return;
+    }
+
+    if (prefetcher) {
+        // the previous run has already left its loop
+        prefetcher->join ();
+    }
+
+    prefetching = true;
+    prefetcher = Glib::Thread::create (sigc::mem_fun (*this, &BatchQueue::prefetchThread), 0, true, true, Glib::THREAD_PRIORITY_LOW);
+}
+
+void BatchQueue::prefetchThread ()
+{
+    {
+        MYREADERLOCK(l, entryRW);
+#ifdef _OPENMP
+        // don't take the cores of the running jobs
+        omp_set_num_threads (getThreadsPerJob (getMaxConcurrentJobs ()));
+#endif
+    }
+
+    while (true) {
+        BatchQueueEntry* entry;
+        Glib::ustring fname;
+        bool isRaw;
+
+        {
+            MYWRITERLOCK(l, entryRW);
+
+            entry = getPrefetchCandidate ();
+
+            if (!entry) {
+                prefetching = false;
+                return;
+            }
+
+            entry->prefetched = true;
+            fname = entry->filename;
+            isRaw = entry->thumbnail && entry->thumbnail->getType () == FT_Raw;
+        }
+
+        // same as in the batch processing, errors are reported when the entry is processed
+        int errorCode = 0;
+        rtengine::InitialImage* const ii = rtengine::InitialImage::load (fname, isRaw, &errorCode);
+
+        if (errorCode || !ii) {
+            continue;
+        }
+
+        const unsigned long long bytes = ii->getDataSize ();
+
+        {
+            MYWRITERLOCK(l, entryRW);
+
+            prefetchEstimate = bytes;
+
+            // the entry may have been started or removed from the queue in the meantime
+            if (!stopPrefetch && std::find (fd.begin (), fd.end (), entry) != fd.end () && entry->filename == fname && !entry->processing) {
+                rtengine::ProcessingJob* const job = rtengine::ProcessingJob::create (ii, entry->params, entry->job->fastPipeline ());
+                rtengine::ProcessingJob::destroy (entry->job);
+                entry->job = job;
+                entry->prefetchedBytes = bytes;
+                prefetchedBytes += bytes;
+
+                if (options.rtSettings.verbose) {
+                    printf ("Batch queue: loaded %s in advance\n", fname.c_str ());
+                }
+            }
+        }
+
+        // the job holds its own reference
+        ii->decreaseRef ();
+    }
+}
+
+void BatchQueue::startProcessing ()
+{
+    {
+        MYWRITERLOCK(l, entryRW);
+
+        if (getBusyWorkers () == 0) {
+            // the queue is (re)started
+            sequence = 0;
+            imagesDone = 0;
+            queueStarted = std::chrono::steady_clock::now ();
+        }
+    }
+
+    startIdleWorkers (true);
+}
+
+rtengine::ProcessingJob* BatchQueue::imageReady (Worker& worker, rtengine::IImage16* img)
+{
+
+    BatchQueueEntry* processing = worker.entry;
+
+    if (img) {
+        // learn the memory footprint of the images, it is used to choose the number of concurrent jobs
+        MYWRITERLOCK(l, entryRW);
+        jobFootprint = std::max<unsigned long long> (jobFootprint, static_cast<unsigned long long> (img->getWidth ()) * img->getHeight () * bytesPerPixel);
+    }
+
+    // save image img
+    Glib::ustring fname;
+    SaveFormat saveFormat;
+
+    {
+        // concurrent jobs must not pick the same output file name
+        MyMutex::MyLock outputLock (outputMutex);
+
+        if (processing->outFileName == "") { // auto file name
+            Glib::ustring s = calcAutoFileNameBase (processing->filename, processing->sequence);
+            saveFormat = options.saveFormatBatch;
+            fname = autoCompleteFileName (s, saveFormat.format);
+        } else { // use the save-as filename with automatic completion for uniqueness
+            if (processing->forceFormatOpts) {
+                saveFormat = processing->saveFormat;
+            } else {
+                saveFormat = options.saveFormatBatch;
+            }
+
+            // The output filename's extension is forced to the current or selected output format,
+            // despite what the user have set in the fielneame's field of the "Save as" dialgo box
+            fname = autoCompleteFileName (removeExtension(processing->outFileName), saveFormat.format);
+            //fname = autoCompleteFileName (removeExtension(processing->outFileName), getExtension(processing->outFileName));
+        }
+
+        //printf ("fname=%s, %s\n", fname.c_str(), removeExtension(fname).c_str());
+
+        if (img && fname != "") {
+            // the file is written later by the output writer, create it now so that the name is not given to another image
+            FILE* const placeholder = g_fopen (fname.c_str (), "wb");
+
+            if (placeholder) {
+                fclose (placeholder);
+            }
         }
     }
 
     // save temporary params file name: delete as last thing
     Glib::ustring processedParams = processing->savedParamsFile;
 
+    // the entry stays in the queue until its image is written, so that it can be retried if writing fails
+    const bool written = img && fname != "";
+
+    if (written) {
+        // the job has been deleted by the processing, the entry needs a new one to be saved with the queue or retried
+        processing->job = rtengine::ProcessingJob::create (processing->filename, processing->thumbnail->getType () == FT_Raw, processing->params, worker.fast);
+
+        // hand the image over to the output writer, it frees it and removes the entry from the queue
+        queueOutput ({img, fname, saveFormat, processing});
+    } else if (img) {
+        img->free ();
+    }
+
     // delete from the queue
     bool queueEmptied = false;
     bool remove_button_set = false;
+    bool startIdle = false;
+    int totalDone;
+
+    const auto now = std::chrono::steady_clock::now ();
+    const auto entryTime = now - worker.entryStarted;
+    ++worker.imagesDone;
+    worker.busyTime += entryTime;
 
     {
         MYWRITERLOCK(l, entryRW);
 
-        delete processing;
+        if (!written) {
+            const auto pos = std::find (fd.begin (), fd.end (), processing);
+
+            if (pos != fd.end ()) {
+                fd.erase (pos);
+            }
+
+            delete processing;
+        }
+
         processing = nullptr;
+        worker.entry = nullptr;
+        totalDone = ++imagesDone;
 
-        fd.erase (fd.begin());
+        const int maxJobs = getMaxConcurrentJobs ();
 
-        // return next job
-        if (fd.empty()) {
-            queueEmptied = true;
+        // return next job, unless the thread budget changed: the worker is then restarted by startIdleWorkers()
+        if (std::none_of (fd.begin (), fd.end (), [] (const ThumbBrowserEntryBase* fdEntry) { return !fdEntry->processing; })) {
+            queueEmptied = getBusyWorkers () == 0;
         } else if (listener && listener->canStartNext ()) {
-            BatchQueueEntry* next = static_cast<BatchQueueEntry*>(fd[0]);
-            // tag it as selected and set sequence
-            next->processing = true;
-            next->sequence = ++sequence;
-            processing = next;
-
-            // remove from selection
-            if (processing->selected) {
-                std::vector<ThumbBrowserEntryBase*>::iterator pos = std::find (selected.begin(), selected.end(), processing);
-
-                if (pos != selected.end()) {
-                    selected.erase (pos);
-                }
-
-                processing->selected = false;
+            if (getBusyWorkers () < maxJobs && worker.threads == getThreadsPerJob (maxJobs)) {
+                processing = assignNextEntry (worker);
             }
 
+            startIdle = true;
             // remove button set
-            remove_button_set = true;
+            remove_button_set = processing != nullptr;
+        }
+    }
+
+    if (options.rtSettings.verbose) {
+        printf ("Batch queue: job %d processed an image in %.1f s, job throughput %.1f images/min, overall throughput %.1f images/min\n",
+                worker.id, std::chrono::duration<double> (entryTime).count (),
+                imagesPerMinute (worker.imagesDone, worker.busyTime), imagesPerMinute (totalDone, now - queueStarted));
+
+        if (queueEmptied) {
+            printf ("Batch queue: %d image(s) processed at %.1f images/min\n", totalDone, imagesPerMinute (totalDone, now - queueStarted));
         }
     }
 
@@ -683,6 +1068,37 @@ rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
         processing->removeButtonSet ();
     }
 
+    // now that the footprint of the images is known, more jobs may run concurrently
+    if (startIdle) {
+        startIdleWorkers (false);
+    }
+
+    startPrefetch ();
+
+    if (written) {
+        saveBatchQueue ();
+    } else {
+        entryRemoved (processedParams);
+    }
+
+    if (queueEmptied) {
+        // the queue is reported as done once all the images are on disk
+        waitForOutputs ();
+
+        // the entries whose image could not be written are back in the queue
+        MYREADERLOCK(l, entryRW);
+        queueEmptied = fd.empty ();
+    }
+
+    redraw ();
+    notifyListener (queueEmptied);
+
+    return processing ? processing->job : nullptr;
+}
+
+// Saves the queue once an entry has been removed from it, then deletes the params file of that entry
+void BatchQueue::entryRemoved (const Glib::ustring& processedParams)
+{
     if (saveBatchQueue ()) {
         ::g_remove (processedParams.c_str ());
 
@@ -710,11 +1126,6 @@ rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
             } catch (Glib::Exception&) {}
         }
     }
-
-    redraw ();
-    notifyListener (queueEmptied);
-
-    return processing ? processing->job : nullptr;
 }
 
 // Calculates automatic filename of processed batch entry, but just the base name
@@ -892,14 +1303,19 @@ Glib::ustring BatchQueue::autoCompleteFileName (const Glib::ustring& fileName, c
     return "";
 }
 
-void BatchQueue::setProgress (double p)
+void BatchQueue::setProgress (Worker& worker, double p)
 {
 
-    if (processing) {
-        processing->progress = p;
+    if (worker.entry) {
+        worker.entry->progress = p;
     }
 
-    // No need to acquire the GUI, setProgressUI will do it
+    redrawFromIdle ();
+}
+
+void BatchQueue::redrawFromIdle ()
+{
+    // No need to acquire the GUI, redraw will do it
     const auto func = [](gpointer data) -> gboolean {
         static_cast<BatchQueue*>(data)->redraw();
         return FALSE;
@@ -961,20 +1377,32 @@ void BatchQueue::redrawNeeded (LWButton* button)
     queue_draw ();
 }
 
-void BatchQueue::error (Glib::ustring msg)
+void BatchQueue::error (Worker& worker, Glib::ustring msg)
 {
 
+    BatchQueueEntry* const processing = worker.entry;
+
     if (processing && processing->processing) {
         // restore failed thumb
         BatchQueueButtonSet* bqbs = new BatchQueueButtonSet (processing);
         bqbs->setButtonListener (this);
         processing->addButtonSet (bqbs);
         processing->processing = false;
-        processing->job = rtengine::ProcessingJob::create(processing->filename, processing->thumbnail->getType() == FT_Raw, processing->params);
-        processing = nullptr;
+        processing->job = rtengine::ProcessingJob::create(processing->filename, processing->thumbnail->getType() == FT_Raw, processing->params, worker.fast);
         redraw ();
     }
 
+    {
+        MYWRITERLOCK(l, entryRW);
+        worker.entry = nullptr;
+    }
+
+    notifyError (msg);
+}
+
+void BatchQueue::notifyError (const Glib::ustring& msg)
+{
+
     if (listener) {
         NLParams* params = new NLParams;
         params->listener = listener;
@@ -984,3 +1412,133 @@ void BatchQueue::error (Glib::ustring msg)
         idle_register.add(bqnotifylistenerUI, params);
     }
 }
+
+void BatchQueue::queueOutput (const OutputImage& output)
+{
+    Glib::Threads::Mutex::Lock lock (outputQueueMutex);
+
+    // wait for the writer if it falls behind, this keeps the memory held by the processed images bounded
+    while (outputQueue.size () >= maxQueuedOutputs) {
+        outputQueueCond.wait (outputQueueMutex);
+    }
+
+    outputQueue.push_back (output);
+    ++outputsPending;
+
+    if (!writer) {
+        writer = Glib::Thread::create (sigc::mem_fun (*this, &BatchQueue::writerThread), 0, true, true, Glib::THREAD_PRIORITY_NORMAL);
+    }
+
+    outputQueueCond.broadcast ();
+}
+
+void BatchQueue::waitForOutputs ()
+{
+    Glib::Threads::Mutex::Lock lock (outputQueueMutex);
+
+    while (outputsPending > 0) {
+        outputQueueCond.wait (outputQueueMutex);
+    }
+}
+
+void BatchQueue::writerThread ()
+{
+    Glib::Threads::Mutex::Lock lock (outputQueueMutex);
+
+    while (true) {
+        while (outputQueue.empty () && !stopWriter) {
+            outputQueueCond.wait (outputQueueMutex);
+        }
+
+        if (outputQueue.empty ()) {
+            return;
+        }
+
+        OutputImage output = std::move (outputQueue.front ());
+        outputQueue.pop_front ();
+        // there is room in the queue again
+        outputQueueCond.broadcast ();
+
+        lock.release ();
+
+        if (!writeOutput (output)) {
+            notifyError (M("MAIN_MSG_CANNOTSAVE") + "\n" + output.fname);
+        }
+
+        lock.acquire ();
+
+        --outputsPending;
+        outputQueueCond.broadcast ();
+    }
+}
+
+bool BatchQueue::writeOutput (OutputImage& output)
+{
+    const SaveFormat& saveFormat = output.saveFormat;
+    int err = 0;
+
+    if (saveFormat.format == "tif") {
+        err = output.img->saveAsTIFF (output.fname, saveFormat.tiffBits, saveFormat.tiffUncompressed, saveFormat.threads);
+    } else if (saveFormat.format == "png") {
+        err = output.img->saveAsPNG (output.fname, saveFormat.pngCompression, saveFormat.pngBits, saveFormat.threads);
+    } else if (saveFormat.format == "jpg") {
+        err = output.img->saveAsJPEG (output.fname, saveFormat.jpegQuality, saveFormat.jpegSubSamp);
+    }
+
+    output.img->free ();
+
+    BatchQueueEntry* const entry = output.entry;
+
+    if (err) {
+        // remove the placeholder or the partially written file
+        ::g_remove (output.fname.c_str ());
+
+        // restore the entry, so that it can be retried
+        BatchQueueButtonSet* bqbs = new BatchQueueButtonSet (entry);
+        bqbs->setButtonListener (this);
+        entry->addButtonSet (bqbs);
+
+        {
+            MYWRITERLOCK(l, entryRW);
+            entry->processing = false;
+        }
+
+        redrawFromIdle ();
+        return false;
+    }
+
+    syncFile (output.fname);
+
+    if (saveFormat.saveParams) {
+        // We keep the extension to avoid overwriting the profile when we have
+        // the same output filename with different extension
+        entry->params.save (output.fname + ".out" + paramFileExtension);
+    }
+
+    if (entry->thumbnail) {
+        entry->thumbnail->imageDeveloped ();
+        entry->thumbnail->imageRemovedFromQueue ();
+    }
+
+    const Glib::ustring processedParams = entry->savedParamsFile;
+
+    {
+        MYWRITERLOCK(l, entryRW);
+
+        const auto pos = std::find (fd.begin (), fd.end (), entry);
+
+        if (pos != fd.end ()) {
+            fd.erase (pos);
+        }
+
+        rtengine::ProcessingJob::destroy (entry->job);
+        delete entry;
+    }
+
+    entryRemoved (processedParams);
+
+    redrawFromIdle ();
+    notifyListener (false);
+
+    return true;
+}
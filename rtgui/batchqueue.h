@@ -18,6 +18,11 @@
 #ifndef _BATCHQUEUE_
 #define _BATCHQUEUE_
 
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
 #include <gtkmm.h>
 #include "threadutils.h"
 #include "batchqueueentry.h"
@@ -39,7 +44,6 @@ class FileCatalog;
 
 class BatchQueue final :
     public ThumbBrowserBase,
-    public rtengine::BatchProcessingListener,
     public LWButtonListener
 {
 public:
@@ -62,9 +66,6 @@ public:
         return (!fd.empty());
     }
 
-    rtengine::ProcessingJob* imageReady (rtengine::IImage16* img);
-    void error (Glib::ustring msg);
-    void setProgress (double p);
     void rightClicked (ThumbBrowserEntryBase* entry);
     void doubleClicked (ThumbBrowserEntryBase* entry);
     bool keyPressed (GdkEventKey* event);
@@ -83,6 +84,37 @@ public:
     static int calcMaxThumbnailHeight();
 
 protected:
+    class Worker;
+
+    rtengine::ProcessingJob* imageReady (Worker& worker, rtengine::IImage16* img);
+    void error (Worker& worker, Glib::ustring msg);
+    void setProgress (Worker& worker, double p);
+
+    int getMaxConcurrentJobs () const;
+    int getThreadsPerJob (int jobs) const;
+    int getBusyWorkers () const;
+    BatchQueueEntry* assignNextEntry (Worker& worker);
+    void startIdleWorkers (bool fromGuiThread);
+
+    BatchQueueEntry* getPrefetchCandidate ();
+    void startPrefetch ();
+    void prefetchThread ();
+
+    // a processed image waiting to be written by the output writer
+    struct OutputImage {
+        rtengine::IImage16* img;
+        Glib::ustring fname;
+        SaveFormat saveFormat;
+        BatchQueueEntry* entry; // stays in the queue until the image is written
+    };
+
+    void queueOutput (const OutputImage& output);
+    void waitForOutputs ();
+    void writerThread ();
+    bool writeOutput (OutputImage& output);
+    void notifyError (const Glib::ustring& msg);
+    void redrawFromIdle (); // for the threads the GUI may be waiting for
+
     int getMaxThumbnailHeight() const;
     void saveThumbnailHeight (int height);
     int  getThumbnailHeight ();
@@ -90,9 +122,28 @@ protected:
     Glib::ustring autoCompleteFileName (const Glib::ustring& fileName, const Glib::ustring& format);
     Glib::ustring getTempFilenameForParams( const Glib::ustring &filename );
     bool saveBatchQueue ();
+    void entryRemoved (const Glib::ustring& processedParams);
     void notifyListener (bool queueEmptied);
 
-    BatchQueueEntry* processing;  // holds the currently processed image
+    std::vector<std::unique_ptr<Worker>> workers; // one per concurrently processed image, never removed while the queue exists
+    unsigned long long jobFootprint; // estimated memory needed to process one image, learnt from the processed images, 0 if unknown
+    int imagesDone; // number of images processed since the queue has been started
+    std::chrono::steady_clock::time_point queueStarted;
+    MyMutex outputMutex; // serializes the choice of output file names
+    Glib::Thread* prefetcher; // loads the next images of the queue while the current ones are processed
+    bool prefetching; // the prefetcher is running
+    bool stopPrefetch;
+    unsigned long long prefetchedBytes; // memory held by the images loaded in advance
+    unsigned long long prefetchEstimate; // memory held by the last image loaded in advance
+
+    // encodes and writes the processed images, so that the next job can start right away
+    Glib::Thread* writer;
+    bool stopWriter;
+    std::deque<OutputImage> outputQueue;
+    unsigned int outputsPending; // queued or being written
+    // Need to be a Glib::Threads::Mutex because used in a Glib::Threads::Cond object
+    Glib::Threads::Mutex outputQueueMutex;
+    Glib::Threads::Cond outputQueueCond;
     FileCatalog* fileCatalog;
     int sequence; // holds the current sequence index
 
@@ -53,6 +53,8 @@ public:
     int sequence;
     SaveFormat saveFormat;
     bool forceFormatOpts;
+    bool prefetched; // the batch queue tried to load the image in advance
+    unsigned long long prefetchedBytes; // estimated memory held by the image loaded in advance, 0 if none
 
     BatchQueueEntry (rtengine::ProcessingJob* job, const rtengine::procparams::ProcParams& pparams, Glib::ustring fname, int prevw, int prevh, Thumbnail* thm = nullptr);
     ~BatchQueueEntry ();
@@ -34,6 +34,7 @@
 #include <locale.h>
 #include "options.h"
 #include "../rtengine/icons.h"
+#include "../rtengine/memorybudget.h"
 #include "soundman.h"
 #include "rtimage.h"
 #include "version.h"
@@ -44,6 +45,12 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glibmm/threads.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #else
 #include <glibmm/thread.h>
 #include "conio.h"
@@ -100,6 +107,14 @@ int processLineParams ( int argc, char **argv );
 
 bool dontLoadCache ( int argc, char **argv );
 
+#ifndef WIN32
+/* Run as a daemon processing the jobs received on a Unix domain socket
+ * Returns
+ *  0 when a client asked the daemon to quit
+ *  -2 if the socket couldn't be created */
+int processDaemon ( const Glib::ustring& socketPath );
+#endif
+
 int main (int argc, char **argv)
 {
     setlocale (LC_ALL, "");
@@ -315,6 +330,7 @@ int processLineParams ( int argc, char **argv )
     int subsampling = 3;
     int bits = -1;
     std::string outputType = "";
+    Glib::ustring daemonSocket;
     unsigned errors = 0;
 
     for ( int iArg = 1; iArg < argc; iArg++) {
@@ -460,6 +476,39 @@ int processLineParams ( int argc, char **argv )
                     fast_export = true;
                     break;
 
+                case 'm': // memory budget of the image buffers, in MB
+                    if ( iArg + 1 < argc ) {
+                        iArg++;
+                        options.rtSettings.memoryBudget = atoi (argv[iArg]);
+
+                        if (options.rtSettings.memoryBudget < 0) {
+                            options.rtSettings.memoryBudget = 0;
+                        }
+
+                        rtengine::MemoryBudget::getInstance().setLimit (std::size_t (options.rtSettings.memoryBudget) << 20);
+                    } else {
+                        std::cerr << "Error: memory budget missing next to the -m switch" << std::endl;
+                        deleteProcParams (processingParams);
+                        return -3;
+                    }
+
+                    break;
+
+#ifndef WIN32
+
+                case 'D': // daemon mode, the jobs are received on the socket
+                    if ( iArg + 1 < argc ) {
+                        iArg++;
+                        daemonSocket = fname_to_utf8 (argv[iArg]);
+                    } else {
+                        std::cerr << "Error: socket name missing next to the -D switch" << std::endl;
+                        deleteProcParams (processingParams);
+                        return -3;
+                    }
+
+                    break;
+#endif
+
                 case 'c': // MUST be last option
                     while (iArg + 1 < argc) {
                         iArg++;
@@ -569,13 +618,16 @@ int processLineParams ( int argc, char **argv )
                     std::cout << "Usage:" << std::endl;
                     std::cout << "  " << Glib::path_get_basename (argv[0]) << " -c <dir>|<files>   Convert files in batch with default parameters." << std::endl;
                     std::cout << "  " << Glib::path_get_basename (argv[0]) << " <other options> -c <dir>|<files>   Convert files in batch with your own settings." << std::endl;
+#ifndef WIN32
+                    std::cout << "  " << Glib::path_get_basename (argv[0]) << " [-q] -D <socket>   Process the jobs received on a socket, see -D below." << std::endl;
+#endif
                     std::cout << std::endl;
 #ifdef WIN32
                     std::cout << "  -w Do not open the Windows console" << std::endl;
                     std::cout << std::endl;
 #endif
                     std::cout << "Options:" << std::endl;
-                    std::cout << "  " << Glib::path_get_basename (argv[0]) << "[-o <output>|-O <output>] [-q] [-a] [-s|-S] [-p <one.pp3> [-p <two.pp3> ...] ] [-d] [ -j[1-100] [-js<1-3>] | [-b<8|16>] [-t[z] | [-n]] ] [-Y] [-f] -c <input>" << std::endl;
+                    std::cout << "  " << Glib::path_get_basename (argv[0]) << "[-o <output>|-O <output>] [-q] [-a] [-s|-S] [-p <one.pp3> [-p <two.pp3> ...] ] [-d] [ -j[1-100] [-js<1-3>] | [-b<8|16>] [-t[z] | [-n]] ] [-Y] [-f] [-m <MB>] -c <input>" << std::endl;
                     std::cout << std::endl;
                     std::cout << "  -c <files>       Specify one or more input files or directory." << std::endl;
                     std::cout << "                   When specifying directories, Rawtherapee will look for images files that comply with the" << std::endl;
@@ -614,6 +666,17 @@ int processLineParams ( int argc, char **argv )
                     std::cout << "                   Compression is hard-coded to 6." << std::endl;
                     std::cout << "  -Y               Overwrite output if present." << std::endl;
                     std::cout << "  -f               Use the custom fast-export processing pipeline." << std::endl;
+                    std::cout << "  -m <MB>          Memory budget of the image buffers. Memory hungry tools like the noise reduction" << std::endl;
+                    std::cout << "                   choose their tile size to stay within it. 0 (default) means no limit." << std::endl;
+#ifndef WIN32
+                    std::cout << "  -D <socket>      Run as a daemon: initialize once, then process the jobs received on the" << std::endl;
+                    std::cout << "                   <socket> Unix domain socket until a client sends \"quit\"." << std::endl;
+                    std::cout << "                   A job is a list of \"<key> <value>\" lines ended by an empty line:" << std::endl;
+                    std::cout << "                     input <file>, output <file> (both mandatory), profile <file." << pparamsExt << "> (repeatable)," << std::endl;
+                    std::cout << "                     default, sidecar, format <jpg|tif|tifz|png>, quality <1-100>," << std::endl;
+                    std::cout << "                     subsampling <1-3>, bits <8|16>, fast, overwrite." << std::endl;
+                    std::cout << "                   Each job is answered with an \"OK <output>\" or \"ERROR <message>\" line." << std::endl;
+#endif
                     std::cout << std::endl;
                     std::cout << "Your " << pparamsExt << " files can be incomplete, RawTherapee will build the final values as follows:" << std::endl;
                     std::cout << "  1- A new processing profile is created using neutral values," << std::endl;
@@ -660,6 +723,15 @@ int processLineParams ( int argc, char **argv )
         }
     }
 
+#ifndef WIN32
+
+    if ( !daemonSocket.empty() ) {
+        deleteProcParams (processingParams);
+        return processDaemon (daemonSocket);
+    }
+
+#endif
+
     if ( !argv1.empty() ) {
         return 1;
     }
@@ -827,7 +899,8 @@ int processLineParams ( int argc, char **argv )
         if ( !resultImage ) {
             errors++;
             std::cerr << "Error processing: " << inputFile << std::endl;
-            rtengine::ProcessingJob::destroy ( job );
+            // processImage has already deleted the job
+            ii->decreaseRef();
             continue;
         }
 
@@ -870,3 +943,349 @@ int processLineParams ( int argc, char **argv )
 
     return errors > 0 ? -2 : 0;
 }
+
+#ifndef WIN32
+
+namespace
+{
+
+struct DaemonJob {
+    Glib::ustring inputFile;
+    Glib::ustring outputFile;
+    std::vector<Glib::ustring> profiles;
+    std::string outputType = "jpg";
+    int quality = 92;
+    int subsampling = 3;
+    int bits = -1;
+    bool tiffCompressed = false;
+    bool useDefault = false;
+    bool sideProcParams = false;
+    bool fast = false;
+    bool overwrite = false;
+};
+
+// Parses one "<key> <value>" line of a job, returns an empty string on success, the error message otherwise
+Glib::ustring parseDaemonJobLine (const std::string& line, DaemonJob& job)
+{
+    const std::string::size_type sep = line.find (' ');
+    const std::string key = line.substr (0, sep);
+    const Glib::ustring value = sep == std::string::npos ? Glib::ustring() : fname_to_utf8 (line.substr (sep + 1).c_str());
+
+    if (key == "input") {
+        job.inputFile = value;
+    } else if (key == "output") {
+        job.outputFile = value;
+    } else if (key == "profile") {
+        job.profiles.push_back (value);
+    } else if (key == "format") {
+        if (value == "jpg" || value == "tif" || value == "png") {
+            job.outputType = value;
+        } else if (value == "tifz") {
+            job.outputType = "tif";
+            job.tiffCompressed = true;
+        } else {
+            return "unknown format \"" + value + "\"";
+        }
+    } else if (key == "quality") {
+        job.quality = atoi (value.c_str());
+
+        if (job.quality < 1 || job.quality > 100) {
+            return "the quality has to be in the [1-100] range";
+        }
+    } else if (key == "subsampling") {
+        job.subsampling = atoi (value.c_str());
+
+        if (job.subsampling < 1 || job.subsampling > 3) {
+            return "the subsampling has to be in the [1-3] range";
+        }
+    } else if (key == "bits") {
+        job.bits = atoi (value.c_str());
+
+        if (job.bits != 8 && job.bits != 16) {
+            return "the bit depth has to be 8 or 16";
+        }
+    } else if (key == "default") {
+        job.useDefault = true;
+    } else if (key == "sidecar") {
+        job.sideProcParams = true;
+    } else if (key == "fast") {
+        job.fast = true;
+    } else if (key == "overwrite") {
+        job.overwrite = true;
+    } else {
+        return "unknown key \"" + Glib::ustring (key) + "\"";
+    }
+
+    return Glib::ustring();
+}
+
+// Loads the default raw or non-raw processing profile into params, returns false if it couldn't be found
+bool applyDefaultProfile (bool isRaw, const rtengine::FramesMetaData* metaData, rtengine::procparams::ProcParams& params)
+{
+    const Glib::ustring& defProf = isRaw ? options.defProfRaw : options.defProfImg;
+    rtengine::procparams::PartialProfile* profile = nullptr;
+
+    if (defProf == DEFPROFILE_DYNAMIC) {
+        profile = ProfileStore::getInstance()->loadDynamicProfile (metaData);
+    } else {
+        const Glib::ustring profPath = options.findProfilePath (defProf);
+
+        if ((isRaw ? options.is_defProfRawMissing() : options.is_defProfImgMissing()) || profPath.empty()) {
+            return false;
+        }
+
+        profile = new rtengine::procparams::PartialProfile (true, isRaw);
+
+        if (profile->load (profPath == DEFPROFILE_INTERNAL ? DEFPROFILE_INTERNAL : Glib::build_filename (profPath, Glib::path_get_basename (defProf) + paramFileExtension))) {
+            profile->deleteInstance();
+            delete profile;
+            return false;
+        }
+    }
+
+    profile->applyTo (&params);
+    profile->deleteInstance();
+    delete profile;
+    return true;
+}
+
+// Processes a job received by the daemon, returns an empty string on success, the error message otherwise
+Glib::ustring processDaemonJob (const DaemonJob& job)
+{
+    if (job.inputFile.empty() || job.outputFile.empty()) {
+        return "the input and output files are mandatory";
+    }
+
+    if (job.inputFile == job.outputFile) {
+        return "cannot overwrite the input file";
+    }
+
+    if (!job.overwrite && Glib::file_test (job.outputFile, Glib::FILE_TEST_EXISTS)) {
+        return "\"" + job.outputFile + "\" already exists";
+    }
+
+    const Glib::ustring ext = getExtension (job.inputFile).lowercase();
+    const bool isRaw = !(ext == "jpg" || ext == "jpeg" || ext == "tif" || ext == "tiff" || ext == "png");
+
+    int errorCode;
+    rtengine::InitialImage* ii = rtengine::InitialImage::load (job.inputFile, isRaw, &errorCode, nullptr);
+
+    if (!ii) {
+        return "cannot load \"" + job.inputFile + "\"";
+    }
+
+    // the profiles are applied in the same order as in the command line mode: default, -p files, sidecar
+    rtengine::procparams::ProcParams params;
+
+    if (job.useDefault && !applyDefaultProfile (isRaw, ii->getMetaData(), params)) {
+        ii->decreaseRef();
+        return "default processing profile not found";
+    }
+
+    for (const auto& profile : job.profiles) {
+        // the "load" method doesn't reset the procparams values, so the values found in the file override the current ones
+        if (params.load (profile)) {
+            ii->decreaseRef();
+            return "cannot load \"" + profile + "\"";
+        }
+    }
+
+    if (job.sideProcParams) {
+        const Glib::ustring sideProcessingParams = job.inputFile + paramFileExtension;
+
+        if (Glib::file_test (sideProcessingParams, Glib::FILE_TEST_EXISTS) && params.load (sideProcessingParams)) {
+            ii->decreaseRef();
+            return "cannot load \"" + sideProcessingParams + "\"";
+        }
+    }
+
+    rtengine::ProcessingJob* pjob = rtengine::ProcessingJob::create (ii, params, job.fast);
+
+    if (!pjob) {
+        ii->decreaseRef();
+        return "cannot create the processing job";
+    }
+
+    rtengine::IImage16* resultImage = rtengine::processImage (pjob, errorCode, nullptr, options.tunnelMetaData);
+
+    if (!resultImage) {
+        // processImage has already deleted the job
+        ii->decreaseRef();
+        return "processing failed";
+    }
+
+    if (job.outputType == "jpg") {
+        errorCode = resultImage->saveAsJPEG (job.outputFile, job.quality, job.subsampling);
+    } else if (job.outputType == "tif") {
+        errorCode = resultImage->saveAsTIFF (job.outputFile, job.bits, !job.tiffCompressed);
+    } else {
+        errorCode = resultImage->saveAsPNG (job.outputFile, -1, job.bits);
+    }
+
+    ii->decreaseRef();
+    resultImage->free();
+
+    if (errorCode) {
+        return "cannot save \"" + job.outputFile + "\"";
+    }
+
+    return Glib::ustring();
+}
+
+void sendDaemonReply (int fd, const std::string& reply)
+{
+    const std::string line = reply + '\n';
+    size_t written = 0;
+
+    while (written < line.size()) {
+        const ssize_t n = write (fd, line.data() + written, line.size() - written);
+
+        if (n <= 0) {
+            return; // the client is gone
+        }
+
+        written += n;
+    }
+}
+
+// Processes the jobs of a client until it disconnects, returns true if it asked the daemon to quit
+bool serveDaemonClient (int fd)
+{
+    FILE* const stream = fdopen (fd, "r");
+
+    if (!stream) {
+        close (fd);
+        return false;
+    }
+
+    DaemonJob job;
+    Glib::ustring jobError;
+    bool jobStarted = false;
+    bool quit = false;
+    char* buffer = nullptr;
+    size_t bufferSize = 0;
+    ssize_t length;
+
+    while ((length = getline (&buffer, &bufferSize, stream)) >= 0) {
+        std::string line (buffer, length);
+
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+            line.pop_back();
+        }
+
+        if (!line.empty()) {
+            if (!jobStarted && line == "quit") {
+                quit = true;
+                break;
+            }
+
+            jobStarted = true;
+
+            if (jobError.empty()) {
+                jobError = parseDaemonJobLine (line, job);
+            }
+
+            continue;
+        }
+
+        if (!jobStarted) {
+            continue;
+        }
+
+        if (jobError.empty()) {
+            std::cout << "Processing: " << job.inputFile << std::endl;
+            jobError = processDaemonJob (job);
+        }
+
+        if (jobError.empty()) {
+            sendDaemonReply (fd, "OK " + job.outputFile);
+        } else {
+            std::cerr << "Error: " << jobError << std::endl;
+            sendDaemonReply (fd, "ERROR " + jobError);
+        }
+
+        job = DaemonJob();
+        jobError.clear();
+        jobStarted = false;
+    }
+
+    free (buffer);
+    fclose (stream);
+    return quit;
+}
+
+}
+
+int processDaemon ( const Glib::ustring& socketPath )
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    const std::string path = Glib::filename_from_utf8 (socketPath);
+
+    if (path.size() >= sizeof (address.sun_path)) {
+        std::cerr << "Error: the socket name is too long: " << socketPath << std::endl;
+        return -2;
+    }
+
+    strncpy (address.sun_path, path.c_str(), sizeof (address.sun_path) - 1);
+
+    const int server = socket (AF_UNIX, SOCK_STREAM, 0);
+
+    if (server < 0) {
+        std::cerr << "Error: cannot create the socket" << std::endl;
+        return -2;
+    }
+
+    if (bind (server, reinterpret_cast<sockaddr*> (&address), sizeof (address)) < 0) {
+        // the socket may be a leftover of a daemon which didn't exit cleanly, it's stale if nobody answers on it
+        const int probe = socket (AF_UNIX, SOCK_STREAM, 0);
+        const bool inUse = probe >= 0 && connect (probe, reinterpret_cast<sockaddr*> (&address), sizeof (address)) == 0;
+
+        if (probe >= 0) {
+            close (probe);
+        }
+
+        if (inUse || unlink (path.c_str()) || bind (server, reinterpret_cast<sockaddr*> (&address), sizeof (address)) < 0) {
+            std::cerr << "Error: cannot bind the socket " << socketPath << std::endl;
+            close (server);
+            return -2;
+        }
+    }
+
+    if (listen (server, 16) < 0) {
+        std::cerr << "Error: cannot listen on the socket " << socketPath << std::endl;
+        close (server);
+        unlink (path.c_str());
+        return -2;
+    }
+
+    // writing to a client which disconnected must not kill the daemon
+    signal (SIGPIPE, SIG_IGN);
+
+    std::cout << "Waiting for jobs on " << socketPath << std::endl;
+
+    // The clients are served one after the other, each job already uses all the cores
+    bool quit = false;
+
+    while (!quit) {
+        const int client = accept (server, nullptr, nullptr);
+
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "Error: cannot accept connections on the socket " << socketPath << std::endl;
+            break;
+        }
+
+        quit = serveDaemonClient (client);
+    }
+
+    close (server);
+    unlink (path.c_str());
+
+    return quit ? 0 : -2;
+}
+
+#endif
@@ -314,6 +314,7 @@ void Options::setDefaults ()
     saveFormat.tiffBits = 16;
     saveFormat.tiffUncompressed = true;
     saveFormat.saveParams = true;
+    saveFormat.threads = 0;
 
     saveFormatBatch.format = "jpg";
     saveFormatBatch.jpegQuality = 92;
@@ -323,6 +324,7 @@ void Options::setDefaults ()
     saveFormatBatch.tiffBits = 16;
     saveFormatBatch.tiffUncompressed = true;
     saveFormatBatch.saveParams = true;
+    saveFormatBatch.threads = 0;
 
     savePathTemplate = "%p1/converted/%f";
     savePathFolder = "";
@@ -434,6 +436,7 @@ void Options::setDefaults ()
     histogramFullMode = false;
     curvebboxpos = 1;
     prevdemo = PD_Sidecar;
+    progressivePreview = true;
     rgbDenoiseThreadLimit = 0;
 #if defined( _OPENMP ) && defined( __x86_64__ )
     clutCacheSize = omp_get_num_procs();
@@ -442,6 +445,8 @@ void Options::setDefaults ()
 #endif
     filledProfile = false;
     maxInspectorBuffers = 2; //  a rather conservative value for low specced systems...
+    batchQueueJobs = 0;
+    batchQueuePrefetchMemory = 1024;
     serializeTiffRead = true;
 
     FileBrowserToolbarSingleRow = false;
@@ -617,6 +622,12 @@ void Options::setDefaults ()
     gimpPluginShowInfoDialog = true;
     maxRecentFolders = 15;
     rtSettings.lensfunDbDirectory = ""; // set also in main.cc and main-cli.cc
+    rtSettings.demosaicCacheSize = 0;
+    rtSettings.batchStripHeight = 0;
+    rtSettings.batchStripMinSize = 40;
+    rtSettings.memoryBudget = 0;
+    rtSettings.bufferPoolSize = 512;
+    rtSettings.halfFloatStageCache = false;
 }
 
 Options* Options::copyFrom (Options* other)
@@ -806,6 +817,10 @@ void Options::readFromFile (Glib::ustring fname)
                     saveFormat.tiffUncompressed = keyFile.get_boolean ("Output", "TiffUncompressed");
                 }
 
+                if (keyFile.has_key ("Output", "Threads")) {
+                    saveFormat.threads = keyFile.get_integer ("Output", "Threads");
+                }
+
                 if (keyFile.has_key ("Output", "SaveProcParams")) {
                     saveFormat.saveParams = keyFile.get_boolean ("Output", "SaveProcParams");
                 }
@@ -839,6 +854,10 @@ void Options::readFromFile (Glib::ustring fname)
                     saveFormatBatch.tiffUncompressed = keyFile.get_boolean ("Output", "TiffUncompressedBatch");
                 }
 
+                if (keyFile.has_key ("Output", "ThreadsBatch")) {
+                    saveFormatBatch.threads = keyFile.get_integer ("Output", "ThreadsBatch");
+                }
+
                 if (keyFile.has_key ("Output", "SaveProcParamsBatch")) {
                     saveFormatBatch.saveParams = keyFile.get_boolean ("Output", "SaveProcParamsBatch");
                 }
@@ -1125,6 +1144,38 @@ void Options::readFromFile (Glib::ustring fname)
                     clutCacheSize = keyFile.get_integer ("Performance", "ClutCacheSize");
                 }
 
+                if (keyFile.has_key ("Performance", "DemosaicCacheSize")) {
+                    rtSettings.demosaicCacheSize = keyFile.get_integer ("Performance", "DemosaicCacheSize");
+                }
+
+                if (keyFile.has_key ("Performance", "BatchStripHeight")) {
+                    rtSettings.batchStripHeight = keyFile.get_integer ("Performance", "BatchStripHeight");
+                }
+
+                if (keyFile.has_key ("Performance", "BatchStripMinSize")) {
+                    rtSettings.batchStripMinSize = keyFile.get_integer ("Performance", "BatchStripMinSize");
+                }
+
+                if (keyFile.has_key ("Performance", "MemoryBudget")) {
+                    rtSettings.memoryBudget = keyFile.get_integer ("Performance", "MemoryBudget");
+                }
+
+                if (keyFile.has_key ("Performance", "BufferPoolSize")) {
+                    rtSettings.bufferPoolSize = keyFile.get_integer ("Performance", "BufferPoolSize");
+                }
+
+                if (keyFile.has_key ("Performance", "HalfFloatStageCache")) {
+                    rtSettings.halfFloatStageCache = keyFile.get_boolean ("Performance", "HalfFloatStageCache");
+                }
+
+                if (keyFile.has_key ("Performance", "BatchQueueJobs")) {
+                    batchQueueJobs = keyFile.get_integer ("Performance", "BatchQueueJobs");
+                }
+
+                if (keyFile.has_key ("Performance", "BatchQueuePrefetchMemory")) {
+                    batchQueuePrefetchMemory = keyFile.get_integer ("Performance", "BatchQueuePrefetchMemory");
+                }
+
                 if (keyFile.has_key ("Performance", "MaxInspectorBuffers")) {
                     maxInspectorBuffers = keyFile.get_integer ("Performance", "MaxInspectorBuffers");
                 }
@@ -1133,6 +1184,10 @@ void Options::readFromFile (Glib::ustring fname)
                     prevdemo = (prevdemo_t)keyFile.get_integer ("Performance", "PreviewDemosaicFromSidecar");
                 }
 
+                if (keyFile.has_key ("Performance", "ProgressivePreview")) {
+                    progressivePreview = keyFile.get_boolean ("Performance", "ProgressivePreview");
+                }
+
                 if (keyFile.has_key ("Performance", "Daubechies")) {
                     rtSettings.daubech = keyFile.get_boolean ("Performance", "Daubechies");
                 }
@@ -1919,8 +1974,17 @@ void Options::saveToFile (Glib::ustring fname)
         keyFile.set_integer ("Performance", "LevNRLISS", rtSettings.leveldnliss);
         keyFile.set_integer ("Performance", "SIMPLNRAUT", rtSettings.leveldnautsimpl);
         keyFile.set_integer ("Performance", "ClutCacheSize", clutCacheSize);
+        keyFile.set_integer ("Performance", "DemosaicCacheSize", rtSettings.demosaicCacheSize);
+        keyFile.set_integer ("Performance", "BatchStripHeight", rtSettings.batchStripHeight);
+        keyFile.set_integer ("Performance", "BatchStripMinSize", rtSettings.batchStripMinSize);
+        keyFile.set_integer ("Performance", "MemoryBudget", rtSettings.memoryBudget);
+        keyFile.set_integer ("Performance", "BufferPoolSize", rtSettings.bufferPoolSize);
+        keyFile.set_boolean ("Performance", "HalfFloatStageCache", rtSettings.halfFloatStageCache);
         keyFile.set_integer ("Performance", "MaxInspectorBuffers", maxInspectorBuffers);
+        keyFile.set_integer ("Performance", "BatchQueueJobs", batchQueueJobs);
+        keyFile.set_integer ("Performance", "BatchQueuePrefetchMemory", batchQueuePrefetchMemory);
         keyFile.set_integer ("Performance", "PreviewDemosaicFromSidecar", prevdemo);
+        keyFile.set_boolean ("Performance", "ProgressivePreview", progressivePreview);
         keyFile.set_boolean ("Performance", "Daubechies", rtSettings.daubech);
         keyFile.set_boolean ("Performance", "SerializeTiffRead", serializeTiffRead);
 
@@ -1931,6 +1995,7 @@ void Options::saveToFile (Glib::ustring fname)
         keyFile.set_integer ("Output", "PngBps", saveFormat.pngBits);
         keyFile.set_integer ("Output", "TiffBps", saveFormat.tiffBits);
         keyFile.set_boolean ("Output", "TiffUncompressed", saveFormat.tiffUncompressed);
+        keyFile.set_integer ("Output", "Threads", saveFormat.threads);
         keyFile.set_boolean ("Output", "SaveProcParams", saveFormat.saveParams);
 
         keyFile.set_string  ("Output", "FormatBatch", saveFormatBatch.format);
@@ -1940,6 +2005,7 @@ void Options::saveToFile (Glib::ustring fname)
         keyFile.set_integer ("Output", "PngBpsBatch", saveFormatBatch.pngBits);
         keyFile.set_integer ("Output", "TiffBpsBatch", saveFormatBatch.tiffBits);
         keyFile.set_boolean ("Output", "TiffUncompressedBatch", saveFormatBatch.tiffUncompressed);
+        keyFile.set_integer ("Output", "ThreadsBatch", saveFormatBatch.threads);
         keyFile.set_boolean ("Output", "SaveProcParamsBatch", saveFormatBatch.saveParams);
 
         keyFile.set_string  ("Output", "PathTemplate", savePathTemplate);
@@ -2250,6 +2316,8 @@ void Options::load (bool lightweight)
         printf ("Cache directory (cacheBaseDir) = %s\n", cacheBaseDir.c_str());
     }
 
+    options.rtSettings.demosaicCacheDir = Glib::build_filename (cacheBaseDir, "demosaic");
+
     // Update profile's path and recreate it if necessary
     options.updatePaths();
 
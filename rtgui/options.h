@@ -52,7 +52,8 @@ struct SaveFormat {
         jpegSubSamp (2),
         tiffBits (8),
         tiffUncompressed (true),
-        saveParams (true)
+        saveParams (true),
+        threads (0)
     {
     }
 
@@ -64,6 +65,7 @@ struct SaveFormat {
     int tiffBits;
     bool tiffUncompressed;
     bool saveParams;
+    int threads;  // number of threads used to compress the output file, 0 = all available
 };
 
 enum ThFileType {FT_Invalid = -1, FT_None = 0, FT_Raw = 1, FT_Jpeg = 2, FT_Tiff = 3, FT_Png = 4, FT_Custom = 5, FT_Tiff16 = 6, FT_Png16 = 7, FT_Custom16 = 8};
@@ -268,9 +270,12 @@ public:
     Glib::ustring clutsDir;
     int rgbDenoiseThreadLimit; // maximum number of threads for the denoising tool ; 0 = use the maximum available
     int maxInspectorBuffers;   // maximum number of buffers (i.e. images) for the Inspector feature
+    int batchQueueJobs;        // number of images processed at the same time by the batch queue ; 0 = automatic
+    int batchQueuePrefetchMemory; // maximum memory in MB used by the images the batch queue loads in advance ; 0 = no prefetch
     int clutCacheSize;
     bool filledProfile;  // Used as reminder for the ProfilePanel "mode"
     prevdemo_t prevdemo; // Demosaicing method used for the <100% preview
+    bool progressivePreview; // show a coarse preview before the slow tools are applied at the preview scale
     bool serializeTiffRead;
 
     bool menuGroupRank;
@@ -587,7 +587,12 @@ Gtk::Widget* Preferences::getPerformancePanel ()
     cprevdemo->set_active (1);
     hbprevdemo->pack_start (*lprevdemo, Gtk::PACK_SHRINK);
     hbprevdemo->pack_start (*cprevdemo);
-    fprevdemo->add (*hbprevdemo);
+    cprogressive = Gtk::manage ( new Gtk::CheckButton (M ("PREFERENCES_PROGRESSIVEPREVIEW")) );
+    cprogressive->set_tooltip_text (M ("PREFERENCES_PROGRESSIVEPREVIEW_TOOLTIP"));
+    Gtk::VBox* vbprevdemo = Gtk::manage (new Gtk::VBox ());
+    vbprevdemo->pack_start (*hbprevdemo, Gtk::PACK_SHRINK, 0);
+    vbprevdemo->pack_start (*cprogressive, Gtk::PACK_SHRINK, 0);
+    fprevdemo->add (*vbprevdemo);
     mainContainer->pack_start (*fprevdemo, Gtk::PACK_SHRINK, 4);
 
     Gtk::Frame* ftiffserialize = Gtk::manage (new Gtk::Frame (M ("PREFERENCES_SERIALIZE_TIFF_READ")));
@@ -616,6 +621,21 @@ Gtk::Widget* Preferences::getPerformancePanel ()
     fclut->add (*clutCacheSizeHB);
     mainContainer->pack_start (*fclut, Gtk::PACK_SHRINK, 4);
 
+    Gtk::Frame* fdemosaicCache = Gtk::manage ( new Gtk::Frame (M ("PREFERENCES_DEMOSAICCACHE")) );
+    Gtk::HBox* demosaicCacheSizeHB = Gtk::manage ( new Gtk::HBox () );
+    demosaicCacheSizeHB->set_spacing (4);
+    demosaicCacheSizeHB->set_tooltip_text (M ("PREFERENCES_DEMOSAICCACHE_TOOLTIP"));
+    Gtk::Label* demosaicCacheSizeLbl = Gtk::manage ( new Gtk::Label (M ("PREFERENCES_DEMOSAICCACHE_LABEL") + ":", Gtk::ALIGN_START));
+    demosaicCacheSizeSB = Gtk::manage ( new Gtk::SpinButton () );
+    demosaicCacheSizeSB->set_digits (0);
+    demosaicCacheSizeSB->set_increments (256, 1024);
+    demosaicCacheSizeSB->set_max_length (6);
+    demosaicCacheSizeSB->set_range (0, 100000);
+    demosaicCacheSizeHB->pack_start (*demosaicCacheSizeLbl, Gtk::PACK_SHRINK, 0);
+    demosaicCacheSizeHB->pack_end (*demosaicCacheSizeSB, Gtk::PACK_SHRINK, 0);
+    fdemosaicCache->add (*demosaicCacheSizeHB);
+    mainContainer->pack_start (*fdemosaicCache, Gtk::PACK_SHRINK, 4);
+
     Gtk::Frame* finspect = Gtk::manage ( new Gtk::Frame (M ("PREFERENCES_INSPECT_LABEL")) );
     Gtk::HBox* maxIBuffersHB = Gtk::manage ( new Gtk::HBox () );
     maxIBuffersHB->set_spacing (4);
@@ -631,6 +651,39 @@ Gtk::Widget* Preferences::getPerformancePanel ()
     finspect->add (*maxIBuffersHB);
     mainContainer->pack_start (*finspect, Gtk::PACK_SHRINK, 4);
 
+    Gtk::Frame* fbatchQueue = Gtk::manage ( new Gtk::Frame (M ("PREFERENCES_BATCH_PROCESSING")) );
+    Gtk::HBox* batchQueueJobsHB = Gtk::manage ( new Gtk::HBox () );
+    batchQueueJobsHB->set_spacing (4);
+    batchQueueJobsHB->set_tooltip_text (M ("PREFERENCES_BATCHQUEUEJOBS_TOOLTIP"));
+    Gtk::Label* batchQueueJobsLbl = Gtk::manage ( new Gtk::Label (M ("PREFERENCES_BATCHQUEUEJOBS_LABEL") + ":", Gtk::ALIGN_START));
+    batchQueueJobsSB = Gtk::manage ( new Gtk::SpinButton () );
+    batchQueueJobsSB->set_digits (0);
+    batchQueueJobsSB->set_increments (1, 2);
+    batchQueueJobsSB->set_max_length (2);
+#ifdef _OPENMP
+    batchQueueJobsSB->set_range (0, omp_get_num_procs());
+#else
+    batchQueueJobsSB->set_range (0, 1);
+#endif
+    batchQueueJobsHB->pack_start (*batchQueueJobsLbl, Gtk::PACK_SHRINK, 0);
+    batchQueueJobsHB->pack_end (*batchQueueJobsSB, Gtk::PACK_SHRINK, 0);
+    Gtk::HBox* batchQueuePrefetchHB = Gtk::manage ( new Gtk::HBox () );
+    batchQueuePrefetchHB->set_spacing (4);
+    batchQueuePrefetchHB->set_tooltip_text (M ("PREFERENCES_BATCHQUEUEPREFETCH_TOOLTIP"));
+    Gtk::Label* batchQueuePrefetchLbl = Gtk::manage ( new Gtk::Label (M ("PREFERENCES_BATCHQUEUEPREFETCH_LABEL") + ":", Gtk::ALIGN_START));
+    batchQueuePrefetchSB = Gtk::manage ( new Gtk::SpinButton () );
+    batchQueuePrefetchSB->set_digits (0);
+    batchQueuePrefetchSB->set_increments (128, 1024);
+    batchQueuePrefetchSB->set_max_length (5);
+    batchQueuePrefetchSB->set_range (0, 65536);
+    batchQueuePrefetchHB->pack_start (*batchQueuePrefetchLbl, Gtk::PACK_SHRINK, 0);
+    batchQueuePrefetchHB->pack_end (*batchQueuePrefetchSB, Gtk::PACK_SHRINK, 0);
+    Gtk::VBox* batchQueueVB = Gtk::manage ( new Gtk::VBox () );
+    batchQueueVB->pack_start (*batchQueueJobsHB, Gtk::PACK_SHRINK, 0);
+    batchQueueVB->pack_start (*batchQueuePrefetchHB, Gtk::PACK_SHRINK, 0);
+    fbatchQueue->add (*batchQueueVB);
+    mainContainer->pack_start (*fbatchQueue, Gtk::PACK_SHRINK, 4);
+
     Gtk::Frame* fdenoise = Gtk::manage ( new Gtk::Frame (M ("PREFERENCES_NOISE")) );
     Gtk::VBox* vbdenoise = Gtk::manage ( new Gtk::VBox (Gtk::PACK_SHRINK, 4) );
 
@@ -1754,6 +1807,7 @@ void Preferences::storePreferences ()
     moptions.rtSettings.daubech = cbdaubech->get_active ();
 
     moptions.prevdemo = (prevdemo_t)cprevdemo->get_active_row_number ();
+    moptions.progressivePreview = cprogressive->get_active ();
     moptions.serializeTiffRead = ctiffserialize->get_active();
 
     if (sdcurrent->get_active ()) {
@@ -1821,6 +1875,9 @@ void Preferences::storePreferences ()
 
     moptions.rgbDenoiseThreadLimit = rgbDenoiseTreadLimitSB->get_value_as_int();
     moptions.clutCacheSize = clutCacheSizeSB->get_value_as_int();
+    moptions.batchQueueJobs = batchQueueJobsSB->get_value_as_int();
+    moptions.batchQueuePrefetchMemory = batchQueuePrefetchSB->get_value_as_int();
+    moptions.rtSettings.demosaicCacheSize = demosaicCacheSizeSB->get_value_as_int();
     moptions.maxInspectorBuffers = maxInspectorBuffersSB->get_value_as_int();
 
 // Sounds only on Windows and Linux
@@ -1911,6 +1968,7 @@ void Preferences::fillPreferences ()
     dnautsimpl->set_active (moptions.rtSettings.leveldnautsimpl);
     dnwavlev->set_active (moptions.rtSettings.nrwavlevel);
     cprevdemo->set_active (moptions.prevdemo);
+    cprogressive->set_active (moptions.progressivePreview);
     cbdaubech->set_active (moptions.rtSettings.daubech);
 
 //  cbAutocielab->set_active (moptions.rtSettings.autocielab);
@@ -2040,6 +2098,9 @@ void Preferences::fillPreferences ()
 
     rgbDenoiseTreadLimitSB->set_value (moptions.rgbDenoiseThreadLimit);
     clutCacheSizeSB->set_value (moptions.clutCacheSize);
+    batchQueueJobsSB->set_value (moptions.batchQueueJobs);
+    batchQueuePrefetchSB->set_value (moptions.batchQueuePrefetchMemory);
+    demosaicCacheSizeSB->set_value (moptions.rtSettings.demosaicCacheSize);
     maxInspectorBuffersSB->set_value (moptions.maxInspectorBuffers);
 
     darkFrameDir->set_current_folder ( moptions.rtSettings.darkFramesPath );
@@ -138,6 +138,7 @@ class Preferences : public Gtk::Dialog, public ProfileStoreListener
     Gtk::ComboBoxText* waveletTileSizeCombo;
 
     Gtk::ComboBoxText* cprevdemo;
+    Gtk::CheckButton* cprogressive;
     Gtk::CheckButton* ctiffserialize;
     Gtk::ComboBoxText* curveBBoxPosC;
 
@@ -165,6 +166,9 @@ class Preferences : public Gtk::Dialog, public ProfileStoreListener
 
     Gtk::SpinButton*  rgbDenoiseTreadLimitSB;
     Gtk::SpinButton*  clutCacheSizeSB;
+    Gtk::SpinButton*  demosaicCacheSizeSB;
+    Gtk::SpinButton*  batchQueueJobsSB;
+    Gtk::SpinButton*  batchQueuePrefetchSB;
     Gtk::SpinButton*  maxInspectorBuffersSB;
 
     Gtk::CheckButton* ckbmenuGroupRank;
@@ -20,7 +20,7 @@
 #include "multilangmgr.h"
 #include "guiutils.h"
 
-SaveFormatPanel::SaveFormatPanel () : listener (nullptr)
+SaveFormatPanel::SaveFormatPanel () : listener (nullptr), threads (0)
 {
 
 
@@ -147,6 +147,7 @@ void SaveFormatPanel::init (SaveFormat &sf)
     jpegQual->setValue (sf.jpegQuality);
     savesPP->set_active (sf.saveParams);
     tiffUncompressed->set_active (sf.tiffUncompressed);
+    threads = sf.threads;
     listener = tmp;
 }
 
@@ -175,6 +176,7 @@ SaveFormat SaveFormatPanel::getFormat ()
     sf.jpegSubSamp      = jpegSubSamp->get_active_row_number() + 1;
     sf.tiffUncompressed = tiffUncompressed->get_active();
     sf.saveParams       = savesPP->get_active ();
+    sf.threads          = threads;
     return sf;
 }
 
@@ -47,6 +47,7 @@ protected:
     FormatChangeListener* listener;
     Glib::ustring       fstr[5];
     Gtk::CheckButton*   savesPP;
+    int                 threads;
 
 
 public: